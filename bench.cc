@@ -0,0 +1,571 @@
+/**************************************************************************
+
+Reader/Writer Problem - Benchmark Sweep
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Runs the simulation's benchmark over every combination of
+		lock policy, reader and writer count, critical section
+		length and buffer size given, several times each, and
+		writes one CSV line or JSON object per combination with
+		the mean throughput, its spread over the runs, and the
+		lock wait percentiles. Each run is rw_main() in a child
+		process, so every run starts clean, and it hands its
+		results back through a pipe.
+
+**************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <sys/wait.h>
+#include "rw.h"
+#include "buffer.h"
+
+// Most values a list can hold.
+const int MAX_VALUES = 64;
+
+// A list of numbers from the command line.
+struct value_list
+{
+	long values[MAX_VALUES];
+	int count;
+};
+
+// The sweep, set by check_sweep().
+const char *policy_names[MAX_VALUES];
+int num_policies = 0;
+value_list readers;
+value_list writers;
+value_list read_pcts;
+value_list cs_lengths;
+value_list sizes;		// Buffer sizes, or 0 for the default.
+int total_threads = 8;
+int runs = 3;
+int run_secs = 1;
+bool json = false;
+FILE *out_file;
+
+// Options passed on to every run.
+char **extra_args;
+int num_extra = 0;
+
+/**************************************************************************
+
+Function:	sweep_usage()
+
+Use:		Prints the usage of the program.
+
+Arguments:	1. *prog: The program's name.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void sweep_usage(const char *prog)
+{
+	fprintf(stderr,"\n");
+	fprintf(stderr,"Usage: %s [-p policies] [-r readers] [-w writers] [-M read_pcts -T threads] [-x ns] [-s sizes] [-n runs] [-t secs] [-f csv|json] [-o file] [-- options]\n",prog);
+	fprintf(stderr,"======================================================\n");
+	fprintf(stderr,"Lists are separated by commas. Every combination is run.\n");
+	fprintf(stderr,"-p policies   - lock policies (default reader-pref,writer-pref,phase-fair,futex).\n");
+	fprintf(stderr,"-r readers    - reader counts (default 1,2,4,8).\n");
+	fprintf(stderr,"-w writers    - writer counts (default 1,2).\n");
+	fprintf(stderr,"-M read_pcts  - percentages of -T threads that read, instead of -r and -w.\n");
+	fprintf(stderr,"-T threads    - threads to split with -M (default 8).\n");
+	fprintf(stderr,"-x ns         - critical section lengths in ns (default 0).\n");
+	fprintf(stderr,"-s sizes      - buffer sizes in bytes, k, m or g (default: the runs' own).\n");
+	fprintf(stderr,"-n runs       - runs of each combination (default 3).\n");
+	fprintf(stderr,"-t secs       - length of each run (default 1).\n");
+	fprintf(stderr,"-f csv|json   - output format (default csv).\n");
+	fprintf(stderr,"-o file       - write the results to a file instead of stdout.\n");
+	fprintf(stderr,"-- options    - pass the rest on to every run, such as -k 4 or -P.\n");
+	fprintf(stderr,"\n");
+}
+
+/**************************************************************************
+
+Function:	parse_list()
+
+Use:		Reads a list of numbers separated by commas.
+
+Arguments:	1. *text: The list.
+		2. *list: Where to put the numbers.
+		3. min: The smallest number allowed.
+
+Returns:	false if text isn't a list of numbers, true otherwise.
+
+**************************************************************************/
+
+bool parse_list(const char *text, value_list *list, long min)
+{
+	const char *p = text;
+
+	list->count = 0;
+	while (*p != '\0')
+	{
+		char *end;
+		long value = strtol(p, &end, 10);
+		if (end == p || value < min || list->count == MAX_VALUES)
+			return false;
+		list->values[list->count++] = value;
+
+		// Move past the comma.
+		p = end;
+		if (*p == ',')
+			p++;
+		else if (*p != '\0')
+			return false;
+	}
+
+	return list->count > 0;
+}
+
+/**************************************************************************
+
+Function:	parse_sizes()
+
+Use:		Reads a list of sizes separated by commas, each of which
+		may end in k, m or g.
+
+Arguments:	1. *text: The list.
+		2. *list: Where to put the sizes.
+
+Returns:	false if text isn't a list of sizes, true otherwise.
+
+**************************************************************************/
+
+bool parse_sizes(const char *text, value_list *list)
+{
+	char item[32];
+
+	list->count = 0;
+	while (*text != '\0')
+	{
+		// Copy out the size up to the comma, and read it.
+		size_t len = strcspn(text, ",");
+		if (len == 0 || len >= sizeof(item) || list->count == MAX_VALUES)
+			return false;
+		memcpy(item, text, len);
+		item[len] = '\0';
+		long size = (long) parse_size(item);
+		if (size <= 0)
+			return false;
+		list->values[list->count++] = size;
+
+		// Move past the comma.
+		text += len;
+		if (*text == ',')
+			text++;
+	}
+
+	return list->count > 0;
+}
+
+/**************************************************************************
+
+Function:	check_sweep()
+
+Use:		Reads the sweep from the command line.
+
+Arguments:	1. argc: The number of arguments.
+		2. *argv[]: A char * string that holds the arguments.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void check_sweep(int argc, char *argv[])
+{
+	static char default_policies[] = "reader-pref,writer-pref,phase-fair,futex";
+	char *policy_text = default_policies;
+	int opt;
+
+	// Start from the defaults.
+	parse_list("1,2,4,8", &readers, 1);
+	parse_list("1,2", &writers, 1);
+	parse_list("0", &cs_lengths, 0);
+	parse_list("0", &sizes, 0);
+	out_file = stdout;
+
+	// Read the options. Anything after -- is for the runs.
+	while ((opt = getopt(argc, argv, "p:r:w:M:T:x:s:n:t:f:o:")) != -1)
+	{
+		bool ok = true;
+
+		switch (opt)
+		{
+		case 'p':
+			policy_text = optarg;
+			break;
+		case 'r':
+			ok = parse_list(optarg, &readers, 1);
+			break;
+		case 'w':
+			ok = parse_list(optarg, &writers, 1);
+			break;
+		case 'M':
+			ok = parse_list(optarg, &read_pcts, 0);
+			for (int i = 0; ok && i < read_pcts.count; i++)
+				ok = read_pcts.values[i] <= 100;
+			break;
+		case 'T':
+			total_threads = atoi(optarg);
+			ok = total_threads >= 2;
+			break;
+		case 'x':
+			ok = parse_list(optarg, &cs_lengths, 0);
+			break;
+		case 's':
+			ok = parse_sizes(optarg, &sizes);
+			break;
+		case 'n':
+			runs = atoi(optarg);
+			ok = runs > 0;
+			break;
+		case 't':
+			run_secs = atoi(optarg);
+			ok = run_secs > 0;
+			break;
+		case 'f':
+			ok = strcmp(optarg, "csv") == 0 || strcmp(optarg, "json") == 0;
+			json = strcmp(optarg, "json") == 0;
+			break;
+		case 'o':
+			// Open the output.
+			if ((out_file = fopen(optarg, "w")) == NULL)
+			{
+				fprintf(stderr,"fopen(): %s - %s.\n",optarg,strerror(errno));
+				exit(-1);
+			}
+			break;
+		default:
+			ok = false;
+		}
+
+		// Print the usage then exit.
+		if (!ok)
+		{
+			sweep_usage(argv[0]);
+			exit(-1);
+		}
+	}
+	extra_args = &argv[optind];
+	num_extra = argc - optind;
+
+	// Split the policies, which rw_main() checks.
+	for (char *name = strtok(policy_text, ","); name != NULL; name = strtok(NULL, ","))
+	{
+		if (num_policies == MAX_VALUES)
+		{
+			fprintf(stderr,"too many policies.\n");
+			exit(-1);
+		}
+		policy_names[num_policies++] = name;
+	}
+}
+
+/**************************************************************************
+
+Function:	run_once()
+
+Use:		Runs one benchmark in a child process with its output
+		thrown away, and reads back its results.
+
+Arguments:	1. *name: The lock policy.
+		2. nreaders: The number of readers.
+		3. nwriters: The number of writers.
+		4. cs: The critical section length in ns.
+		5. size: The buffer size, or 0 for the default.
+		6. *result: Where to put the results.
+
+Returns:	false if the run failed, true otherwise.
+
+**************************************************************************/
+
+bool run_once(const char *name, int nreaders, int nwriters, long cs, long size, bench_result *result)
+{
+	char secs[32], rtext[32], wtext[32], cstext[32], stext[32];
+	int fds[2];
+
+	// Build the command line.
+	snprintf(secs, sizeof(secs), "%d", run_secs);
+	snprintf(rtext, sizeof(rtext), "%d", nreaders);
+	snprintf(wtext, sizeof(wtext), "%d", nwriters);
+	snprintf(cstext, sizeof(cstext), "%ld", cs);
+	snprintf(stext, sizeof(stext), "%ld", size);
+	const char *args[16 + MAX_VALUES];
+	int argc = 0;
+	args[argc++] = "readerwriter";
+	args[argc++] = "-b";
+	args[argc++] = "-l";
+	args[argc++] = "-t";
+	args[argc++] = secs;
+	args[argc++] = "-p";
+	args[argc++] = name;
+	args[argc++] = "-x";
+	args[argc++] = cstext;
+	if (size > 0)
+	{
+		args[argc++] = "-s";
+		args[argc++] = stext;
+	}
+	for (int i = 0; i < num_extra && i < MAX_VALUES; i++)
+		args[argc++] = extra_args[i];
+	args[argc++] = rtext;
+	args[argc++] = wtext;
+	args[argc] = NULL;
+
+	if (pipe(fds) != 0)
+	{
+		fprintf(stderr,"pipe(): %s.\n",strerror(errno));
+		exit(-1);
+	}
+	fflush(out_file);
+	pid_t pid = fork();
+	if (pid < 0)
+	{
+		fprintf(stderr,"fork(): %s.\n",strerror(errno));
+		exit(-1);
+	}
+
+	// The child runs the benchmark and sends back the results.
+	if (pid == 0)
+	{
+		close(fds[0]);
+		int null = open("/dev/null", O_WRONLY);
+		if (null >= 0)
+			dup2(null, STDOUT_FILENO);
+		// Start getopt() over for the run's options.
+		optind = 0;
+		rw_main(argc, (char **) args, "reader-pref");
+		fflush(stdout);
+		if (write(fds[1], &last_result, sizeof(last_result)) != sizeof(last_result))
+			_exit(1);
+		_exit(0);
+	}
+
+	// Read the results, then check how the child ended.
+	close(fds[1]);
+	bool ok = read(fds[0], result, sizeof(*result)) == sizeof(*result);
+	close(fds[0]);
+	int status;
+	if (waitpid(pid, &status, 0) < 0)
+	{
+		fprintf(stderr,"waitpid(): %s.\n",strerror(errno));
+		exit(-1);
+	}
+
+	return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/**************************************************************************
+
+Function:	print_header()
+
+Use:		Starts the output.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void print_header()
+{
+	if (json)
+		fprintf(out_file,"[\n");
+	else
+		fprintf(out_file,"policy,readers,writers,cs_ns,runs,read_pct,ops_sec_mean,ops_sec_stddev,"
+			"ops_sec_min,ops_sec_max,read_ops_sec,write_ops_sec,read_p50_ns,read_p99_ns,"
+			"read_p999_ns,write_p50_ns,write_p99_ns,write_p999_ns,cpu_ns_op,cycles_op,"
+			"llc_misses_op,reader_jain,writer_jain,writer_max_wait_ns,buffer_bytes,read_mb_s,write_mb_s\n");
+}
+
+/**************************************************************************
+
+Function:	print_point()
+
+Use:		Sums up the runs of one combination and prints it.
+
+Arguments:	1. *name: The lock policy.
+		2. nreaders: The number of readers.
+		3. nwriters: The number of writers.
+		4. cs: The critical section length in ns.
+		5. *results: The runs.
+		6. count: The number of runs.
+		7. first: Whether it is the first combination printed.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void print_point(const char *name, int nreaders, int nwriters, long cs, const bench_result *results,
+		 int count, bool first)
+{
+	double sum = 0, sum_sq = 0, low = 0, high = 0;
+	double reads = 0, writes = 0;
+	double p[6] = {};
+	double cost[3] = {};
+	double fair[3] = {};
+	double mb[2] = {};
+
+	// Add up the runs. The percentiles and costs are averaged over
+	// them, and a cost any run couldn't count stays at -1.
+	for (int i = 0; i < count; i++)
+	{
+		const bench_result *r = &results[i];
+		double rate = (r->reads + r->writes) / r->secs;
+		sum += rate;
+		sum_sq += rate * rate;
+		low = i == 0 || rate < low ? rate : low;
+		high = i == 0 || rate > high ? rate : high;
+		reads += r->reads / r->secs;
+		writes += r->writes / r->secs;
+		p[0] += r->read_p50;
+		p[1] += r->read_p99;
+		p[2] += r->read_p999;
+		p[3] += r->write_p50;
+		p[4] += r->write_p99;
+		p[5] += r->write_p999;
+		double run_cost[3] = { r->cpu_ns_per_op, r->cycles_per_op, r->llc_misses_per_op };
+		for (int j = 0; j < 3; j++)
+			cost[j] = cost[j] < 0 || run_cost[j] < 0 ? -1 : cost[j] + run_cost[j];
+		// A side that starved in any run has no index.
+		fair[0] = fair[0] < 0 || r->reader_jain < 0 ? -1 : fair[0] + r->reader_jain;
+		fair[1] = fair[1] < 0 || r->writer_jain < 0 ? -1 : fair[1] + r->writer_jain;
+		fair[2] = r->writer_max_wait > fair[2] ? r->writer_max_wait : fair[2];
+		mb[0] += r->read_mb_sec;
+		mb[1] += r->write_mb_sec;
+	}
+	double mean = sum / count;
+	double var = count > 1 ? (sum_sq - count * mean * mean) / (count - 1) : 0;
+	double stddev = sqrt(var > 0 ? var : 0);
+	double read_pct = reads + writes > 0 ? 100 * reads / (reads + writes) : 0;
+	for (int i = 0; i < 6; i++)
+		p[i] /= count;
+	for (int i = 0; i < 3; i++)
+		cost[i] = cost[i] < 0 ? -1 : cost[i] / count;
+	for (int i = 0; i < 2; i++)
+		fair[i] = fair[i] < 0 ? -1 : fair[i] / count;
+	mb[0] /= count;
+	mb[1] /= count;
+
+	if (json)
+		fprintf(out_file,"%s  {\"policy\": \"%s\", \"readers\": %d, \"writers\": %d, \"cs_ns\": %ld, "
+			"\"runs\": %d, \"read_pct\": %.1f, \"ops_sec_mean\": %.0f, \"ops_sec_stddev\": %.0f, "
+			"\"ops_sec_min\": %.0f, \"ops_sec_max\": %.0f, \"read_ops_sec\": %.0f, "
+			"\"write_ops_sec\": %.0f, \"read_p50_ns\": %.0f, \"read_p99_ns\": %.0f, "
+			"\"read_p999_ns\": %.0f, \"write_p50_ns\": %.0f, \"write_p99_ns\": %.0f, "
+			"\"write_p999_ns\": %.0f, \"cpu_ns_op\": %.1f, \"cycles_op\": %.1f, "
+			"\"llc_misses_op\": %.3f, \"reader_jain\": %.3f, \"writer_jain\": %.3f, "
+			"\"writer_max_wait_ns\": %.0f, \"buffer_bytes\": %ld, \"read_mb_s\": %.1f, "
+			"\"write_mb_s\": %.1f}",first ? "" : ",\n",name,nreaders,nwriters,cs,count,
+			read_pct,mean,stddev,low,high,reads / count,writes / count,p[0],p[1],p[2],p[3],p[4],p[5],
+			cost[0],cost[1],cost[2],fair[0],fair[1],fair[2],results[0].buffer_bytes,mb[0],mb[1]);
+	else
+		fprintf(out_file,"%s,%d,%d,%ld,%d,%.1f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,"
+			"%.1f,%.1f,%.3f,%.3f,%.3f,%.0f,%ld,%.1f,%.1f\n",name,nreaders,nwriters,cs,count,read_pct,mean,
+			stddev,low,high,reads / count,writes / count,p[0],p[1],p[2],p[3],p[4],p[5],cost[0],cost[1],
+			cost[2],fair[0],fair[1],fair[2],results[0].buffer_bytes,mb[0],mb[1]);
+	fflush(out_file);
+}
+
+/**************************************************************************
+
+Function:	main()
+
+Use:		Runs the sweep.
+
+Arguments:	1. argc: The number of arguments.
+		2. *argv[]: A char * string that holds the arguments.
+
+Returns:	The program's exit status.
+
+**************************************************************************/
+
+int main(int argc, char *argv[])
+{
+	check_sweep(argc, argv);
+
+	// The reader and writer counts to run, from -M or -r and -w.
+	int counts[MAX_VALUES * MAX_VALUES][2];
+	int num_counts = 0;
+	if (read_pcts.count > 0)
+	{
+		for (int i = 0; i < read_pcts.count; i++)
+		{
+			// Keep at least one of each.
+			int r = (int) (total_threads * read_pcts.values[i] / 100);
+			r = r < 1 ? 1 : r > total_threads - 1 ? total_threads - 1 : r;
+			counts[num_counts][0] = r;
+			counts[num_counts++][1] = total_threads - r;
+		}
+	}
+	else
+	{
+		for (int i = 0; i < readers.count; i++)
+			for (int j = 0; j < writers.count; j++)
+			{
+				counts[num_counts][0] = (int) readers.values[i];
+				counts[num_counts++][1] = (int) writers.values[j];
+			}
+	}
+
+	bench_result *results = (bench_result *) calloc(runs, sizeof(bench_result));
+	if (results == NULL)
+	{
+		fprintf(stderr,"calloc(): results - %s.\n",strerror(errno));
+		exit(-1);
+	}
+
+	print_header();
+
+	// Run every combination.
+	int total = num_policies * num_counts * cs_lengths.count * sizes.count;
+	int point = 0;
+	bool first = true;
+	for (int p = 0; p < num_policies; p++)
+		for (int c = 0; c < num_counts; c++)
+			for (int x = 0; x < cs_lengths.count; x++)
+				for (int s = 0; s < sizes.count; s++)
+				{
+					int nreaders = counts[c][0];
+					int nwriters = counts[c][1];
+					long cs = cs_lengths.values[x];
+					long size = sizes.values[s];
+
+					fprintf(stderr,"[%d/%d] %s, %d readers, %d writers, %ld ns",++point,total,
+						policy_names[p],nreaders,nwriters,cs);
+					if (size > 0)
+						fprintf(stderr,", %ld bytes",size);
+					fprintf(stderr,"\n");
+
+					// Run it, and skip it if it fails.
+					int count = 0;
+					for (int i = 0; i < runs; i++)
+						if (run_once(policy_names[p], nreaders, nwriters, cs, size, &results[count]))
+							count++;
+					if (count < runs)
+					{
+						fprintf(stderr,"%d of %d runs failed, skipping.\n",runs - count,runs);
+						continue;
+					}
+
+					print_point(policy_names[p], nreaders, nwriters, cs, results, count, first);
+					first = false;
+				}
+
+	if (json)
+		fprintf(out_file,"%s]\n",first ? "" : "\n");
+
+	free(results);
+	if (out_file != stdout)
+		fclose(out_file);
+
+	return 0;
+}
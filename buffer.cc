@@ -0,0 +1,353 @@
+/**************************************************************************
+
+Reader/Writer Problem - Shared Buffer
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	The buffer the readers and writers share. Chopping a
+		byte only changes the length, and refilling only rewrites
+		what was chopped, so neither depends on the buffer's size.
+
+		A mapped file is mapped privately: writers change the
+		mapping, never the file, and refilling reads the chopped
+		bytes back from the file. A private mapping isn't shared
+		across fork(), so when the readers and writers are
+		processes, the file is read into shared memory instead.
+
+**************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <new>
+#include "buffer.h"
+#include "shm.h"
+
+/**************************************************************************
+
+Function:	fill_text()
+
+Use:		Writes the repeated text over part of a buffer.
+
+Arguments:	1. *data: The start of the buffer.
+		2. from: The first byte to write.
+		3. to: One past the last byte to write.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void fill_text(char *data, size_t from, size_t to)
+{
+	const size_t n = sizeof(buffer_text) - 1;
+
+	// Each byte gets the byte of the text at the same offset.
+	for (size_t i = from; i < to; i++)
+		data[i] = buffer_text[i % n];
+}
+
+/**************************************************************************
+
+Function:	buffer_init()
+
+Use:		Sets up a full buffer.
+
+Arguments:	1. *b: The buffer.
+		2. size: The length of the text when full.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void buffer_init(shared_buffer *b, size_t size)
+{
+	// Allocate room for the text where every reader and writer can
+	// see it.
+	b->data = (char *) shared_alloc(size);
+
+	// Fill it.
+	fill_text(b->data, 0, size);
+	b->size = size;
+	b->len = size;
+	b->fd = -1;
+}
+
+/**************************************************************************
+
+Function:	buffer_map()
+
+Use:		Sets up a full buffer by mapping a file. The buffer is
+		the size of the file.
+
+Arguments:	1. *b: The buffer.
+		2. *path: The file.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void buffer_map(shared_buffer *b, const char *path)
+{
+	struct stat st;
+
+	// Open the file and find its size.
+	b->fd = open(path, O_RDONLY);
+	if (b->fd < 0)
+	{
+		fprintf(stderr,"open(): %s - %s.\n",path,strerror(errno));
+		exit(-1);
+	}
+	if (fstat(b->fd, &st) != 0)
+	{
+		fprintf(stderr,"fstat(): %s - %s.\n",path,strerror(errno));
+		exit(-1);
+	}
+	if (st.st_size == 0)
+	{
+		fprintf(stderr,"%s is empty.\n",path);
+		exit(-1);
+	}
+
+	// Processes can't share a private mapping, so read the file into
+	// shared memory.
+	if (process_mode)
+	{
+		b->data = (char *) shared_alloc(st.st_size);
+		b->size = st.st_size;
+		b->len = 0;
+		buffer_refill(b);
+		return;
+	}
+
+	// Map it privately, so writes stay out of the file.
+	void *mem = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, b->fd, 0);
+	if (mem == MAP_FAILED)
+	{
+		fprintf(stderr,"mmap(): %s - %s.\n",path,strerror(errno));
+		exit(-1);
+	}
+
+	b->data = (char *) mem;
+	b->size = st.st_size;
+	b->len = st.st_size;
+}
+
+/**************************************************************************
+
+Function:	buffer_dup()
+
+Use:		Copies a buffer into one new allocation, so the copy can
+		be freed with a single free().
+
+Arguments:	1. *from: The buffer to copy.
+
+Returns:	The copy.
+
+**************************************************************************/
+
+shared_buffer *buffer_dup(const shared_buffer *from)
+{
+	// Allocate the header with the text right after it.
+	char *mem = (char *) malloc(sizeof(shared_buffer) + from->size);
+	if (mem == NULL)
+	{
+		fprintf(stderr,"malloc(): %zu byte buffer - %s.\n",from->size,strerror(errno));
+		exit(-1);
+	}
+	shared_buffer *b = new (mem) shared_buffer();
+
+	// Copy the text that is there, and keep the rest of the room.
+	size_t len = from->len.load();
+	b->data = mem + sizeof(shared_buffer);
+	b->size = from->size;
+	memcpy(b->data, from->data, len);
+	b->len = len;
+	b->fd = from->fd;
+
+	return b;
+}
+
+/**************************************************************************
+
+Function:	buffer_chop()
+
+Use:		Chops the last byte off the text. The buffer must not be
+		empty.
+
+Arguments:	1. *b: The buffer.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void buffer_chop(shared_buffer *b)
+{
+	// Only the length changes. The byte stays until a refill.
+	b->len.store(b->len.load(std::memory_order_relaxed) - 1, std::memory_order_release);
+}
+
+/**************************************************************************
+
+Function:	buffer_refill()
+
+Use:		Puts back the bytes that have been chopped off.
+
+Arguments:	1. *b: The buffer.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void buffer_refill(shared_buffer *b)
+{
+	size_t len = b->len.load(std::memory_order_relaxed);
+
+	// Read the chopped bytes back from the file, or rewrite the text.
+	if (b->fd >= 0)
+	{
+		while (len < b->size)
+		{
+			ssize_t n = pread(b->fd, b->data + len, b->size - len, len);
+			if (n <= 0)
+			{
+				fprintf(stderr,"pread(): mapped file - %s.\n",n == 0 ? "file shrank" : strerror(errno));
+				exit(-1);
+			}
+			len += n;
+		}
+	}
+	else
+		fill_text(b->data, len, b->size);
+
+	b->len.store(b->size, std::memory_order_release);
+}
+
+/**************************************************************************
+
+Function:	buffer_destroy()
+
+Use:		Frees a buffer set up by buffer_init() or buffer_map().
+
+Arguments:	1. *b: The buffer.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void buffer_destroy(shared_buffer *b)
+{
+	// Unmap a mapped file, or free the text.
+	if (b->fd >= 0 && !process_mode)
+		munmap(b->data, b->size);
+	else
+		shared_free(b->data);
+
+	// Close the file.
+	if (b->fd >= 0)
+	{
+		close(b->fd);
+		b->fd = -1;
+	}
+
+	b->data = NULL;
+}
+
+/**************************************************************************
+
+Function:	write_view()
+
+Use:		Writes text and a newline to a file descriptor with one
+		writev(), straight from where the text is, so it is
+		never copied in userspace. The caller holds the lock, so
+		the view it writes is consistent.
+
+Arguments:	1. fd: Where to write.
+		2. *data: The text.
+		3. len: Its length.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void write_view(int fd, const char *data, size_t len)
+{
+	struct iovec iov[2];
+	int n = 2;
+
+	iov[0].iov_base = (void *) data;
+	iov[0].iov_len = len;
+	iov[1].iov_base = (void *) "\n";
+	iov[1].iov_len = 1;
+
+	// Keep writing until everything is out.
+	struct iovec *v = iov;
+	while (n > 0)
+	{
+		ssize_t done = writev(fd, v, n);
+		if (done < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr,"writev(): reader output - %s.\n",strerror(errno));
+			exit(-1);
+		}
+
+		// Skip what was written.
+		while (n > 0 && (size_t) done >= v->iov_len)
+		{
+			done -= v->iov_len;
+			v++;
+			n--;
+		}
+		if (n > 0)
+		{
+			v->iov_base = (char *) v->iov_base + done;
+			v->iov_len -= done;
+		}
+	}
+}
+
+/**************************************************************************
+
+Function:	parse_size()
+
+Use:		Reads a size, which may end in k, m or g.
+
+Arguments:	1. *arg: The size.
+
+Returns:	The size in bytes, or 0 if it isn't valid.
+
+**************************************************************************/
+
+size_t parse_size(const char *arg)
+{
+	char *end;
+	unsigned long long n = strtoull(arg, &end, 10);
+
+	// Apply the suffix, if any.
+	switch (*end)
+	{
+	case 'g': case 'G':
+		n <<= 10;
+		// Fall through.
+	case 'm': case 'M':
+		n <<= 10;
+		// Fall through.
+	case 'k': case 'K':
+		n <<= 10;
+		end++;
+		break;
+	}
+
+	// Anything else after the number isn't valid.
+	if (*end != '\0' || arg[0] == '-')
+		return 0;
+
+	return (size_t) n;
+}
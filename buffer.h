@@ -0,0 +1,41 @@
+/**************************************************************************
+
+Reader/Writer Problem - Shared Buffer
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Declares the buffer the readers and writers share. It
+		replaces the fixed string, keeps its length in a header
+		so nobody has to scan for it, and can be any size. It can
+		also be a file mapped into memory.
+
+**************************************************************************/
+#ifndef BUFFER_H
+#define BUFFER_H
+
+#include <stddef.h>
+#include <atomic>
+
+struct shared_buffer
+{
+	std::atomic<size_t> len;	// Length of the text. It can be read
+					// without the lock.
+	size_t size;			// Length of the text when full.
+	char *data;			// The text. It isn't terminated.
+	int fd;				// The file the text comes from, or -1.
+};
+
+// The text the buffer is filled with, repeated.
+const char buffer_text[] = "All work and no play makes Jack a dull boy.";
+
+void buffer_init(shared_buffer *b, size_t size);
+void buffer_map(shared_buffer *b, const char *path);
+shared_buffer *buffer_dup(const shared_buffer *from);
+void buffer_chop(shared_buffer *b);
+void buffer_refill(shared_buffer *b);
+void buffer_destroy(shared_buffer *b);
+void write_view(int fd, const char *data, size_t len);
+size_t parse_size(const char *arg);
+
+#endif
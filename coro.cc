@@ -0,0 +1,447 @@
+/**************************************************************************
+
+Reader/Writer Problem - Coroutines
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Runs reader and writer coroutines on a small executor,
+		and gives them a reader/writer lock that never parks a
+		thread.
+
+		The executor is a queue of ready coroutines shared by a
+		few threads. Each thread takes the oldest one and resumes
+		it until it suspends again. A thread with nothing to run
+		yields the processor rather than sleep.
+
+		A coroutine that can't have the lock is queued on the lock
+		and suspended. Whoever releases the lock hands it to the
+		waiters at the front of the queue, a writer or a run of
+		readers, and queues them on the executor. Both queues are
+		guarded by spin locks held for a few instructions.
+
+**************************************************************************/
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include "coro.h"
+
+// The ready coroutines, oldest first.
+spin_lock ready_guard;
+coro_node *ready_head;
+coro_node *ready_tail;
+
+// Coroutines that haven't returned yet.
+std::atomic<long> coros_left;
+
+// The executor's threads.
+pthread_t *coro_threads;
+int ncoro_threads;
+
+// The calling thread's index, or -1 if it isn't an executor thread.
+thread_local int my_coro_worker = -1;
+
+/**************************************************************************
+
+Function:	spin_acquire()
+
+Use:		Takes a spin lock.
+
+Arguments:	1. *s: The lock.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void spin_acquire(spin_lock *s)
+{
+	while (s->flag.test_and_set(std::memory_order_acquire))
+		sched_yield();
+}
+
+/**************************************************************************
+
+Function:	spin_release()
+
+Use:		Releases a spin lock.
+
+Arguments:	1. *s: The lock.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void spin_release(spin_lock *s)
+{
+	s->flag.clear(std::memory_order_release);
+}
+
+/**************************************************************************
+
+Function:	coro_post()
+
+Use:		Queues a suspended coroutine to be resumed. The caller
+		must not touch the node afterwards, as another thread
+		may already be running the coroutine.
+
+Arguments:	1. *node: The coroutine.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void coro_post(coro_node *node)
+{
+	node->next = NULL;
+
+	spin_acquire(&ready_guard);
+	if (ready_tail != NULL)
+		ready_tail->next = node;
+	else
+		ready_head = node;
+	ready_tail = node;
+	spin_release(&ready_guard);
+}
+
+/**************************************************************************
+
+Function:	coro_take()
+
+Use:		Takes the oldest ready coroutine.
+
+Arguments:	None.
+
+Returns:	The coroutine, or NULL if none is ready.
+
+**************************************************************************/
+
+coro_node *coro_take()
+{
+	spin_acquire(&ready_guard);
+	coro_node *node = ready_head;
+	if (node != NULL)
+	{
+		ready_head = node->next;
+		if (ready_head == NULL)
+			ready_tail = NULL;
+	}
+	spin_release(&ready_guard);
+
+	return node;
+}
+
+/**************************************************************************
+
+Function:	coro_created()
+
+Use:		Counts a new coroutine.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void coro_created()
+{
+	coros_left++;
+}
+
+/**************************************************************************
+
+Function:	coro_finished()
+
+Use:		Counts a coroutine that has returned.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void coro_finished()
+{
+	coros_left--;
+}
+
+/**************************************************************************
+
+Function:	grant()
+
+Use:		Hands the lock to the waiters at the front of its queue:
+		a writer if the lock is free, or every reader up to the
+		next writer if no writer holds it. Called with the lock's
+		guard held.
+
+Arguments:	1. *lock: The lock.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void grant(async_rwlock *lock)
+{
+	while (lock->head != NULL && !lock->writer)
+	{
+		lock_waiter *w = (lock_waiter *) lock->head;
+
+		// A writer needs the readers gone too.
+		if (w->exclusive)
+		{
+			if (lock->readers != 0)
+				break;
+			lock->writer = true;
+		}
+		else
+			lock->readers++;
+
+		// Take it off the queue and let it run.
+		lock->head = w->next;
+		if (lock->head == NULL)
+			lock->tail = NULL;
+		coro_post(w);
+	}
+}
+
+/**************************************************************************
+
+Function:	lock_waiter::await_suspend()
+
+Use:		Takes the lock if nobody holds it in the way and nobody
+		is waiting for it. Otherwise, queues the coroutine on the
+		lock and suspends it.
+
+Arguments:	1. h: The coroutine.
+
+Returns:	true if the coroutine was suspended, false if it has the
+		lock and goes on.
+
+**************************************************************************/
+
+bool lock_waiter::await_suspend(std::coroutine_handle<> h)
+{
+	spin_acquire(&lock->guard);
+
+	// Take the lock straight away if it is free enough and no one
+	// is ahead in the queue.
+	if (lock->head == NULL && !lock->writer && (!exclusive || lock->readers == 0))
+	{
+		if (exclusive)
+			lock->writer = true;
+		else
+			lock->readers++;
+		spin_release(&lock->guard);
+		return false;
+	}
+
+	// Otherwise, wait in line.
+	handle = h;
+	next = NULL;
+	if (lock->tail != NULL)
+		lock->tail->next = this;
+	else
+		lock->head = this;
+	lock->tail = this;
+	spin_release(&lock->guard);
+
+	return true;
+}
+
+/**************************************************************************
+
+Function:	async_lock_shared()
+
+Use:		Makes what a reader co_awaits to take the lock.
+
+Arguments:	1. *lock: The lock.
+
+Returns:	The awaiter.
+
+**************************************************************************/
+
+lock_waiter async_lock_shared(async_rwlock *lock)
+{
+	lock_waiter w;
+
+	w.lock = lock;
+	w.exclusive = false;
+	return w;
+}
+
+/**************************************************************************
+
+Function:	async_lock()
+
+Use:		Makes what a writer co_awaits to take the lock.
+
+Arguments:	1. *lock: The lock.
+
+Returns:	The awaiter.
+
+**************************************************************************/
+
+lock_waiter async_lock(async_rwlock *lock)
+{
+	lock_waiter w;
+
+	w.lock = lock;
+	w.exclusive = true;
+	return w;
+}
+
+/**************************************************************************
+
+Function:	async_unlock_shared()
+
+Use:		Releases the lock held by a reader. The last reader out
+		hands it on.
+
+Arguments:	1. *lock: The lock.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void async_unlock_shared(async_rwlock *lock)
+{
+	spin_acquire(&lock->guard);
+	if (--lock->readers == 0)
+		grant(lock);
+	spin_release(&lock->guard);
+}
+
+/**************************************************************************
+
+Function:	async_unlock()
+
+Use:		Releases the lock held by a writer and hands it on.
+
+Arguments:	1. *lock: The lock.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void async_unlock(async_rwlock *lock)
+{
+	spin_acquire(&lock->guard);
+	lock->writer = false;
+	grant(lock);
+	spin_release(&lock->guard);
+}
+
+/**************************************************************************
+
+Function:	coro_thread()
+
+Use:		An executor thread. It resumes ready coroutines until
+		every coroutine has returned.
+
+Arguments:	1. *param: The thread's index.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void *coro_thread(void *param)
+{
+	my_coro_worker = (int) (long) param;
+
+	while (coros_left.load(std::memory_order_relaxed) > 0)
+	{
+		coro_node *node = coro_take();
+
+		// If nothing is ready, let the other threads in.
+		if (node == NULL)
+		{
+			sched_yield();
+			continue;
+		}
+
+		// Run the coroutine until it suspends or returns.
+		node->handle.resume();
+	}
+
+	pthread_exit(0);
+}
+
+/**************************************************************************
+
+Function:	coro_start()
+
+Use:		Starts the executor's threads. The coroutines should
+		already be created, so the threads don't find nothing to
+		do and stop.
+
+Arguments:	1. count: The number of threads.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void coro_start(int count)
+{
+	ncoro_threads = count;
+	coro_threads = (pthread_t *) malloc(count * sizeof(pthread_t));
+	if (coro_threads == NULL)
+	{
+		fprintf(stderr,"malloc(): executor thread ids - %s.\n",strerror(errno));
+		exit(-1);
+	}
+
+	for (long i = 0; i < count; i++)
+	{
+		if (pthread_create(&coro_threads[i],NULL,coro_thread,(void *)i) != 0)
+		{
+			fprintf(stderr,"pthread_create(): executor thread %ld error - %s.\n",i,strerror(errno));
+			exit(-1);
+		}
+	}
+}
+
+/**************************************************************************
+
+Function:	coro_wait()
+
+Use:		Waits for every coroutine to return and the executor's
+		threads to stop.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void coro_wait()
+{
+	for (int i = 0; i < ncoro_threads; i++)
+	{
+		if (pthread_join(coro_threads[i],NULL) != 0)
+		{
+			fprintf(stderr,"pthread_join(): executor thread %d error - %s.\n",i,strerror(errno));
+			exit(-1);
+		}
+	}
+
+	free(coro_threads);
+}
+
+/**************************************************************************
+
+Function:	coro_worker()
+
+Use:		Finds which executor thread the calling thread is.
+
+Arguments:	None.
+
+Returns:	The thread's index, from 0.
+
+**************************************************************************/
+
+int coro_worker()
+{
+	return my_coro_worker;
+}
@@ -0,0 +1,96 @@
+/**************************************************************************
+
+Reader/Writer Problem - Coroutines
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Declares the executor that runs readers and writers as
+		C++20 coroutines, and the asynchronous reader/writer lock
+		they co_await. A coroutine that has to wait for the lock
+		is suspended into the lock's queue instead of blocking
+		its thread.
+
+**************************************************************************/
+#ifndef CORO_H
+#define CORO_H
+
+#include <stdlib.h>
+#include <coroutine>
+#include <atomic>
+
+// A suspended coroutine, queued on the executor or on a lock. The node
+// lives in the coroutine's frame, so queueing it never allocates.
+struct coro_node
+{
+	coro_node *next;
+	std::coroutine_handle<> handle;
+};
+
+void coro_post(coro_node *node);
+void coro_created();
+void coro_finished();
+
+// Suspends the coroutine and queues it on the executor, so the others
+// get a turn.
+struct coro_yield : coro_node
+{
+	bool await_ready() { return false; }
+	void await_suspend(std::coroutine_handle<> h) { handle = h; coro_post(this); }
+	void await_resume() {}
+};
+
+// A reader or writer coroutine. It starts on the executor and frees
+// itself when it returns.
+struct coro_task
+{
+	struct promise_type
+	{
+		promise_type() { coro_created(); }
+		coro_task get_return_object() { return coro_task(); }
+		coro_yield initial_suspend() { return coro_yield(); }
+		std::suspend_never final_suspend() noexcept { coro_finished(); return std::suspend_never(); }
+		void return_void() {}
+		void unhandled_exception() { abort(); }
+	};
+};
+
+// Spin lock for the short critical sections of the executor and the
+// lock. Holders never suspend or block.
+struct spin_lock
+{
+	std::atomic_flag flag;
+};
+
+// Reader/writer lock for coroutines. Waiters are served in order, and
+// every reader at the front of the queue is let in together.
+struct async_rwlock
+{
+	spin_lock guard;	// Guards the rest.
+	long readers;		// Readers holding the lock.
+	bool writer;		// A writer holds the lock.
+	coro_node *head;	// Waiters, oldest first.
+	coro_node *tail;
+};
+
+// What a coroutine co_awaits to take the lock.
+struct lock_waiter : coro_node
+{
+	async_rwlock *lock;
+	bool exclusive;		// A writer, not a reader.
+
+	bool await_ready() { return false; }
+	bool await_suspend(std::coroutine_handle<> h);
+	void await_resume() {}
+};
+
+lock_waiter async_lock_shared(async_rwlock *lock);
+lock_waiter async_lock(async_rwlock *lock);
+void async_unlock_shared(async_rwlock *lock);
+void async_unlock(async_rwlock *lock);
+
+void coro_start(int count);
+void coro_wait();
+int coro_worker();
+
+#endif
@@ -0,0 +1,165 @@
+/**************************************************************************
+
+Reader/Writer Problem - Latency Histograms
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Log-bucketed histograms for lock wait times. Recording a
+		value is a bit scan and an increment, so it is cheap
+		enough to do on every acquire.
+
+**************************************************************************/
+#include <stdio.h>
+#include "hist.h"
+
+thread_local latency_hist *wait_hist;
+
+/**************************************************************************
+
+Function:	hist_bucket()
+
+Use:		Finds the bucket a value goes in. Values below HIST_SUB
+		get a bucket each; above that, the bucket is picked by
+		the highest set bit and the HIST_SUB_BITS bits below it.
+
+Arguments:	1. value: The value.
+
+Returns:	The bucket's index.
+
+**************************************************************************/
+
+int hist_bucket(uint64_t value)
+{
+	if (value < (uint64_t) HIST_SUB)
+		return (int) value;
+
+	int shift = 63 - __builtin_clzll(value) - HIST_SUB_BITS;
+	return (shift + 1) * HIST_SUB + (int) ((value >> shift) & (HIST_SUB - 1));
+}
+
+/**************************************************************************
+
+Function:	hist_upper()
+
+Use:		Finds the largest value that goes in a bucket.
+
+Arguments:	1. bucket: The bucket's index.
+
+Returns:	The bucket's upper bound.
+
+**************************************************************************/
+
+uint64_t hist_upper(int bucket)
+{
+	if (bucket < HIST_SUB)
+		return bucket;
+
+	int shift = bucket / HIST_SUB - 1;
+	uint64_t lower = (uint64_t) (HIST_SUB + bucket % HIST_SUB) << shift;
+	return lower + ((uint64_t) 1 << shift) - 1;
+}
+
+/**************************************************************************
+
+Function:	hist_record()
+
+Use:		Records a value.
+
+Arguments:	1. *h: The histogram.
+		2. value: The value.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void hist_record(latency_hist *h, uint64_t value)
+{
+	h->counts[hist_bucket(value)]++;
+	h->total++;
+	if (value > h->max)
+		h->max = value;
+}
+
+/**************************************************************************
+
+Function:	hist_merge()
+
+Use:		Adds one histogram's values to another.
+
+Arguments:	1. *into: The histogram to add to.
+		2. *from: The histogram to add.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void hist_merge(latency_hist *into, const latency_hist *from)
+{
+	for (int i = 0; i < HIST_BUCKETS; i++)
+		into->counts[i] += from->counts[i];
+	into->total += from->total;
+	if (from->max > into->max)
+		into->max = from->max;
+}
+
+/**************************************************************************
+
+Function:	hist_percentile()
+
+Use:		Finds the value at a percentile. The result is the upper
+		bound of the bucket it falls in, but never more than the
+		largest value recorded.
+
+Arguments:	1. *h: The histogram.
+		2. pct: The percentile, from 0 to 100.
+
+Returns:	The value, or 0 if the histogram is empty.
+
+**************************************************************************/
+
+uint64_t hist_percentile(const latency_hist *h, double pct)
+{
+	if (h->total == 0)
+		return 0;
+
+	// Find how many values are at or below the percentile.
+	uint64_t rank = (uint64_t) (h->total * pct / 100.0 + 0.5);
+	if (rank == 0)
+		rank = 1;
+
+	// Walk the buckets until that many have been seen.
+	uint64_t seen = 0;
+	for (int i = 0; i < HIST_BUCKETS; i++)
+	{
+		seen += h->counts[i];
+		if (seen >= rank)
+			return hist_upper(i) < h->max ? hist_upper(i) : h->max;
+	}
+
+	return h->max;
+}
+
+/**************************************************************************
+
+Function:	hist_print()
+
+Use:		Prints the count and tail percentiles of a histogram of
+		nanosecond waits.
+
+Arguments:	1. *name: What the waits are.
+		2. *h: The histogram.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void hist_print(const char *name, const latency_hist *h)
+{
+	printf("%s: %llu waits, p50 %llu ns, p99 %llu ns, p99.9 %llu ns, max %llu ns\n",name,
+	       (unsigned long long) h->total,
+	       (unsigned long long) hist_percentile(h,50),
+	       (unsigned long long) hist_percentile(h,99),
+	       (unsigned long long) hist_percentile(h,99.9),
+	       (unsigned long long) h->max);
+}
@@ -0,0 +1,40 @@
+/**************************************************************************
+
+Reader/Writer Problem - Latency Histograms
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Declares the log-bucketed histograms that lock waits are
+		recorded in. Each thread records into its own histogram,
+		and they are merged once the threads are joined.
+
+**************************************************************************/
+#ifndef HIST_H
+#define HIST_H
+
+#include <stdint.h>
+
+// Every power of two is split into 2^HIST_SUB_BITS buckets, so a
+// bucket is at most 1/8 (12.5%) wider than its lower bound.
+const int HIST_SUB_BITS = 3;
+const int HIST_SUB = 1 << HIST_SUB_BITS;
+const int HIST_BUCKETS = (64 - HIST_SUB_BITS + 1) * HIST_SUB;
+
+struct latency_hist
+{
+	uint64_t counts[HIST_BUCKETS];
+	uint64_t total;			// Number of values recorded.
+	uint64_t max;			// Largest value recorded.
+};
+
+// The histogram the current thread records its lock waits in, or NULL
+// if waits aren't being timed.
+extern thread_local latency_hist *wait_hist;
+
+void hist_record(latency_hist *h, uint64_t value);
+void hist_merge(latency_hist *into, const latency_hist *from);
+uint64_t hist_percentile(const latency_hist *h, double pct);
+void hist_print(const char *name, const latency_hist *h);
+
+#endif
@@ -0,0 +1,725 @@
+/**************************************************************************
+
+Reader/Writer Problem - Workload Kernels
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Gives readers and writers real work to do on the buffer
+		while they hold the lock, so the length of the critical
+		section follows the size of the buffer. Readers can add
+		up the bytes, count one byte, or copy them out. Writers
+		can fill the text with a letter or swap the case of
+		every letter. Every kernel has a scalar version, an SSE2
+		version and an AVX2 version. The fastest one the
+		processor has is used, unless another is picked with
+		-I. The AVX2 versions are compiled for AVX2 on their
+		own, so the program still runs on processors without it.
+		Elsewhere than x86-64, only the scalar versions exist.
+
+**************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#ifdef __x86_64__
+#include <immintrin.h>
+#define KERNEL_X86
+#endif
+#include "kernel.h"
+
+int read_kernel = READ_NONE;
+int write_kernel = WRITE_NONE;
+
+// The instruction set to use, or -1 for the best there is.
+int kernel_isa_given = -1;
+int kernel_isa_used = ISA_SCALAR;
+
+const char *read_names[] = { "none", "checksum", "search", "copy" };
+const char *write_names[] = { "none", "fill", "transform" };
+const char *isa_names[] = { "scalar", "sse2", "avx2" };
+
+// The versions picked by kernel_setup().
+uint64_t (*read_fn)(const char *data, size_t len);
+void (*write_fn)(char *data, size_t len, char c);
+
+// Where each thread copies to. It grows to the largest read.
+struct copy_area
+{
+	char *data;
+	size_t size;
+
+	~copy_area() { free(data); }
+};
+thread_local copy_area copy_to;
+
+/**************************************************************************
+
+Function:	copy_dest()
+
+Use:		Makes sure the calling thread's copy area can hold a
+		read.
+
+Arguments:	1. len: The length of the read.
+
+Returns:	The copy area.
+
+**************************************************************************/
+
+char *copy_dest(size_t len)
+{
+	if (len > copy_to.size)
+	{
+		char *data = (char *) realloc(copy_to.data, len);
+		if (data == NULL)
+		{
+			fprintf(stderr,"realloc(): copy area - %s.\n",strerror(errno));
+			exit(-1);
+		}
+		copy_to.data = data;
+		copy_to.size = len;
+	}
+
+	return copy_to.data;
+}
+
+/**************************************************************************
+
+Function:	swap_case()
+
+Use:		Swaps the case of a byte if it is a letter.
+
+Arguments:	1. b: The byte.
+
+Returns:	The byte with its case swapped.
+
+**************************************************************************/
+
+inline char swap_case(char b)
+{
+	char lower = b | 0x20;
+	return lower >= 'a' && lower <= 'z' ? b ^ 0x20 : b;
+}
+
+/**************************************************************************
+
+Function:	checksum_scalar()
+
+Use:		Adds up the bytes one at a time.
+
+Arguments:	1. *data: The bytes.
+		2. len: How many there are.
+
+Returns:	The sum.
+
+**************************************************************************/
+
+uint64_t checksum_scalar(const char *data, size_t len)
+{
+	uint64_t sum = 0;
+
+	for (size_t i = 0; i < len; i++)
+		sum += (unsigned char) data[i];
+
+	return sum;
+}
+
+/**************************************************************************
+
+Function:	search_scalar()
+
+Use:		Counts the needles one byte at a time.
+
+Arguments:	1. *data: The bytes.
+		2. len: How many there are.
+
+Returns:	The count.
+
+**************************************************************************/
+
+uint64_t search_scalar(const char *data, size_t len)
+{
+	uint64_t count = 0;
+
+	for (size_t i = 0; i < len; i++)
+		count += data[i] == KERNEL_NEEDLE;
+
+	return count;
+}
+
+/**************************************************************************
+
+Function:	copy_scalar()
+
+Use:		Copies the bytes out one at a time.
+
+Arguments:	1. *data: The bytes.
+		2. len: How many there are.
+
+Returns:	The last byte copied, so the copy is used.
+
+**************************************************************************/
+
+uint64_t copy_scalar(const char *data, size_t len)
+{
+	char *to = copy_dest(len);
+
+	for (size_t i = 0; i < len; i++)
+		to[i] = data[i];
+
+	return len > 0 ? (unsigned char) to[len - 1] : 0;
+}
+
+/**************************************************************************
+
+Function:	fill_scalar()
+
+Use:		Sets the bytes one at a time.
+
+Arguments:	1. *data: The bytes.
+		2. len: How many there are.
+		3. c: What to set them to.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void fill_scalar(char *data, size_t len, char c)
+{
+	for (size_t i = 0; i < len; i++)
+		data[i] = c;
+}
+
+/**************************************************************************
+
+Function:	transform_scalar()
+
+Use:		Swaps the case of the letters one at a time.
+
+Arguments:	1. *data: The bytes.
+		2. len: How many there are.
+		3. c: Not used.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void transform_scalar(char *data, size_t len, char)
+{
+	for (size_t i = 0; i < len; i++)
+		data[i] = swap_case(data[i]);
+}
+
+#ifdef KERNEL_X86
+
+/**************************************************************************
+
+Function:	checksum_sse2()
+
+Use:		Adds up the bytes 16 at a time. psadbw sums each 8
+		bytes into a 64-bit lane.
+
+Arguments:	1. *data: The bytes.
+		2. len: How many there are.
+
+Returns:	The sum.
+
+**************************************************************************/
+
+uint64_t checksum_sse2(const char *data, size_t len)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i acc = zero;
+	size_t i = 0;
+
+	for (; i + 16 <= len; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *) (data + i));
+		acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+	}
+
+	// Add the two lanes, then the bytes left over.
+	uint64_t sum = (uint64_t) _mm_cvtsi128_si64(acc) + (uint64_t) _mm_cvtsi128_si64(_mm_unpackhi_epi64(acc, acc));
+	return sum + checksum_scalar(data + i, len - i);
+}
+
+/**************************************************************************
+
+Function:	search_sse2()
+
+Use:		Counts the needles 16 bytes at a time, from the mask of
+		the bytes that matched.
+
+Arguments:	1. *data: The bytes.
+		2. len: How many there are.
+
+Returns:	The count.
+
+**************************************************************************/
+
+uint64_t search_sse2(const char *data, size_t len)
+{
+	__m128i needle = _mm_set1_epi8(KERNEL_NEEDLE);
+	uint64_t count = 0;
+	size_t i = 0;
+
+	for (; i + 16 <= len; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *) (data + i));
+		count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(v, needle)));
+	}
+
+	return count + search_scalar(data + i, len - i);
+}
+
+/**************************************************************************
+
+Function:	copy_sse2()
+
+Use:		Copies the bytes out 16 at a time.
+
+Arguments:	1. *data: The bytes.
+		2. len: How many there are.
+
+Returns:	The last byte copied, so the copy is used.
+
+**************************************************************************/
+
+uint64_t copy_sse2(const char *data, size_t len)
+{
+	char *to = copy_dest(len);
+	size_t i = 0;
+
+	for (; i + 16 <= len; i += 16)
+		_mm_storeu_si128((__m128i *) (to + i), _mm_loadu_si128((const __m128i *) (data + i)));
+	for (; i < len; i++)
+		to[i] = data[i];
+
+	return len > 0 ? (unsigned char) to[len - 1] : 0;
+}
+
+/**************************************************************************
+
+Function:	fill_sse2()
+
+Use:		Sets the bytes 16 at a time.
+
+Arguments:	1. *data: The bytes.
+		2. len: How many there are.
+		3. c: What to set them to.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void fill_sse2(char *data, size_t len, char c)
+{
+	__m128i v = _mm_set1_epi8(c);
+	size_t i = 0;
+
+	for (; i + 16 <= len; i += 16)
+		_mm_storeu_si128((__m128i *) (data + i), v);
+	fill_scalar(data + i, len - i, c);
+}
+
+/**************************************************************************
+
+Function:	transform_sse2()
+
+Use:		Swaps the case of the letters 16 bytes at a time. A
+		byte is a letter if, lowercased, it is from 'a' to 'z'.
+		The compares are signed, so bytes from 0x80 up never
+		match.
+
+Arguments:	1. *data: The bytes.
+		2. len: How many there are.
+		3. c: Not used.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void transform_sse2(char *data, size_t len, char c)
+{
+	__m128i bit = _mm_set1_epi8(0x20);
+	__m128i below = _mm_set1_epi8('a' - 1);
+	__m128i above = _mm_set1_epi8('z' + 1);
+	size_t i = 0;
+
+	for (; i + 16 <= len; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *) (data + i));
+		__m128i lower = _mm_or_si128(v, bit);
+		__m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, below), _mm_cmpgt_epi8(above, lower));
+		_mm_storeu_si128((__m128i *) (data + i), _mm_xor_si128(v, _mm_and_si128(letter, bit)));
+	}
+	transform_scalar(data + i, len - i, c);
+}
+
+/**************************************************************************
+
+Function:	checksum_avx2()
+
+Use:		Adds up the bytes 32 at a time.
+
+Arguments:	1. *data: The bytes.
+		2. len: How many there are.
+
+Returns:	The sum.
+
+**************************************************************************/
+
+__attribute__((target("avx2")))
+uint64_t checksum_avx2(const char *data, size_t len)
+{
+	__m256i zero = _mm256_setzero_si256();
+	__m256i acc = zero;
+	size_t i = 0;
+
+	for (; i + 32 <= len; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *) (data + i));
+		acc = _mm256_add_epi64(acc, _mm256_sad_epu8(v, zero));
+	}
+
+	// Add the four lanes, then the bytes left over.
+	uint64_t lanes[4];
+	_mm256_storeu_si256((__m256i *) lanes, acc);
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3] + checksum_scalar(data + i, len - i);
+}
+
+/**************************************************************************
+
+Function:	search_avx2()
+
+Use:		Counts the needles 32 bytes at a time.
+
+Arguments:	1. *data: The bytes.
+		2. len: How many there are.
+
+Returns:	The count.
+
+**************************************************************************/
+
+__attribute__((target("avx2")))
+uint64_t search_avx2(const char *data, size_t len)
+{
+	__m256i needle = _mm256_set1_epi8(KERNEL_NEEDLE);
+	uint64_t count = 0;
+	size_t i = 0;
+
+	for (; i + 32 <= len; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *) (data + i));
+		count += __builtin_popcount((unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle)));
+	}
+
+	return count + search_scalar(data + i, len - i);
+}
+
+/**************************************************************************
+
+Function:	copy_avx2()
+
+Use:		Copies the bytes out 32 at a time.
+
+Arguments:	1. *data: The bytes.
+		2. len: How many there are.
+
+Returns:	The last byte copied, so the copy is used.
+
+**************************************************************************/
+
+__attribute__((target("avx2")))
+uint64_t copy_avx2(const char *data, size_t len)
+{
+	char *to = copy_dest(len);
+	size_t i = 0;
+
+	for (; i + 32 <= len; i += 32)
+		_mm256_storeu_si256((__m256i *) (to + i), _mm256_loadu_si256((const __m256i *) (data + i)));
+	for (; i < len; i++)
+		to[i] = data[i];
+
+	return len > 0 ? (unsigned char) to[len - 1] : 0;
+}
+
+/**************************************************************************
+
+Function:	fill_avx2()
+
+Use:		Sets the bytes 32 at a time.
+
+Arguments:	1. *data: The bytes.
+		2. len: How many there are.
+		3. c: What to set them to.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+__attribute__((target("avx2")))
+void fill_avx2(char *data, size_t len, char c)
+{
+	__m256i v = _mm256_set1_epi8(c);
+	size_t i = 0;
+
+	for (; i + 32 <= len; i += 32)
+		_mm256_storeu_si256((__m256i *) (data + i), v);
+	fill_scalar(data + i, len - i, c);
+}
+
+/**************************************************************************
+
+Function:	transform_avx2()
+
+Use:		Swaps the case of the letters 32 bytes at a time, the
+		same way as transform_sse2().
+
+Arguments:	1. *data: The bytes.
+		2. len: How many there are.
+		3. c: Not used.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+__attribute__((target("avx2")))
+void transform_avx2(char *data, size_t len, char c)
+{
+	__m256i bit = _mm256_set1_epi8(0x20);
+	__m256i below = _mm256_set1_epi8('a' - 1);
+	__m256i above = _mm256_set1_epi8('z' + 1);
+	size_t i = 0;
+
+	for (; i + 32 <= len; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *) (data + i));
+		__m256i lower = _mm256_or_si256(v, bit);
+		__m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(lower, below), _mm256_cmpgt_epi8(above, lower));
+		_mm256_storeu_si256((__m256i *) (data + i), _mm256_xor_si256(v, _mm256_and_si256(letter, bit)));
+	}
+	transform_scalar(data + i, len - i, c);
+}
+
+#endif
+
+/**************************************************************************
+
+Function:	isa_supported()
+
+Use:		Checks if the processor has an instruction set.
+
+Arguments:	1. isa: The instruction set.
+
+Returns:	true if it can be used, false otherwise.
+
+**************************************************************************/
+
+bool isa_supported(int isa)
+{
+#ifdef KERNEL_X86
+	if (isa == ISA_SSE2)
+		return __builtin_cpu_supports("sse2");
+	if (isa == ISA_AVX2)
+		return __builtin_cpu_supports("avx2");
+#endif
+	return isa == ISA_SCALAR;
+}
+
+/**************************************************************************
+
+Function:	kernel_parse()
+
+Use:		Reads the kernels from -K: the reader's, then a comma
+		and the writer's. Either can be left out.
+
+Arguments:	1. *spec: What was given, such as "checksum,fill".
+
+Returns:	false if a kernel isn't known, true otherwise.
+
+**************************************************************************/
+
+bool kernel_parse(const char *spec)
+{
+	const char *comma = strchr(spec, ',');
+	size_t rlen = comma != NULL ? (size_t) (comma - spec) : strlen(spec);
+	const char *wname = comma != NULL ? comma + 1 : "";
+
+	read_kernel = READ_NONE;
+	write_kernel = WRITE_NONE;
+
+	// An empty name leaves that side without a kernel.
+	if (rlen > 0)
+	{
+		read_kernel = -1;
+		for (int i = READ_CHECKSUM; i <= READ_COPY; i++)
+			if (strlen(read_names[i]) == rlen && strncmp(read_names[i], spec, rlen) == 0)
+				read_kernel = i;
+	}
+	if (*wname != '\0')
+	{
+		write_kernel = -1;
+		for (int i = WRITE_FILL; i <= WRITE_TRANSFORM; i++)
+			if (strcmp(write_names[i], wname) == 0)
+				write_kernel = i;
+	}
+
+	return read_kernel >= 0 && write_kernel >= 0 && (read_kernel != READ_NONE || write_kernel != WRITE_NONE);
+}
+
+/**************************************************************************
+
+Function:	kernel_use_isa()
+
+Use:		Picks the instruction set from -I.
+
+Arguments:	1. *name: "scalar", "sse2" or "avx2".
+
+Returns:	false if it isn't known or the processor doesn't have
+		it, true otherwise.
+
+**************************************************************************/
+
+bool kernel_use_isa(const char *name)
+{
+	for (int i = ISA_SCALAR; i <= ISA_AVX2; i++)
+		if (strcmp(isa_names[i], name) == 0 && isa_supported(i))
+		{
+			kernel_isa_given = i;
+			return true;
+		}
+
+	return false;
+}
+
+/**************************************************************************
+
+Function:	kernel_setup()
+
+Use:		Picks the version of each kernel for the instruction
+		set given, or the best the processor has.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void kernel_setup()
+{
+	// Without -I, use the widest there is.
+	kernel_isa_used = kernel_isa_given;
+	if (kernel_isa_used < 0)
+		kernel_isa_used = isa_supported(ISA_AVX2) ? ISA_AVX2 : isa_supported(ISA_SSE2) ? ISA_SSE2 : ISA_SCALAR;
+
+	uint64_t (*reads[3][4])(const char *, size_t) =
+	{
+		{ NULL, checksum_scalar, search_scalar, copy_scalar },
+#ifdef KERNEL_X86
+		{ NULL, checksum_sse2, search_sse2, copy_sse2 },
+		{ NULL, checksum_avx2, search_avx2, copy_avx2 },
+#endif
+	};
+	void (*writes[3][3])(char *, size_t, char) =
+	{
+		{ NULL, fill_scalar, transform_scalar },
+#ifdef KERNEL_X86
+		{ NULL, fill_sse2, transform_sse2 },
+		{ NULL, fill_avx2, transform_avx2 },
+#endif
+	};
+
+	read_fn = reads[kernel_isa_used][read_kernel];
+	write_fn = writes[kernel_isa_used][write_kernel];
+}
+
+/**************************************************************************
+
+Function:	kernel_read()
+
+Use:		Runs the reader's kernel on what it read.
+
+Arguments:	1. *data: What was read.
+		2. len: Its length.
+
+Returns:	What the kernel made of it, to be kept so the work
+		isn't optimized away.
+
+**************************************************************************/
+
+uint64_t kernel_read(const char *data, size_t len)
+{
+	return read_fn(data, len);
+}
+
+/**************************************************************************
+
+Function:	kernel_write()
+
+Use:		Runs the writer's kernel on the text. A fill uses a
+		different letter each time.
+
+Arguments:	1. *data: The text.
+		2. len: Its length.
+		3. seq: The writer's count of writes.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void kernel_write(char *data, size_t len, long seq)
+{
+	write_fn(data, len, 'a' + seq % 26);
+}
+
+/**************************************************************************
+
+Function:	kernel_read_name()
+
+Use:		Names the reader's kernel.
+
+Arguments:	None.
+
+Returns:	Its name.
+
+**************************************************************************/
+
+const char *kernel_read_name()
+{
+	return read_names[read_kernel];
+}
+
+/**************************************************************************
+
+Function:	kernel_write_name()
+
+Use:		Names the writer's kernel.
+
+Arguments:	None.
+
+Returns:	Its name.
+
+**************************************************************************/
+
+const char *kernel_write_name()
+{
+	return write_names[write_kernel];
+}
+
+/**************************************************************************
+
+Function:	kernel_isa_name()
+
+Use:		Names the instruction set the kernels run with.
+
+Arguments:	None.
+
+Returns:	Its name.
+
+**************************************************************************/
+
+const char *kernel_isa_name()
+{
+	return isa_names[kernel_isa_used];
+}
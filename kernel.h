@@ -0,0 +1,60 @@
+/**************************************************************************
+
+Reader/Writer Problem - Workload Kernels
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Declares the work readers and writers can do on the
+		buffer while they hold the lock, picked with -K, and the
+		instruction sets it can be run with, picked with -I.
+
+**************************************************************************/
+#ifndef KERNEL_H
+#define KERNEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// What a reader does with what it reads.
+enum read_kernel_kind
+{
+	READ_NONE,
+	READ_CHECKSUM,		// Adds up the bytes.
+	READ_SEARCH,		// Counts the bytes that are KERNEL_NEEDLE.
+	READ_COPY		// Copies them out.
+};
+
+// What a writer does to the text before it chops it.
+enum write_kernel_kind
+{
+	WRITE_NONE,
+	WRITE_FILL,		// Sets every byte to one letter.
+	WRITE_TRANSFORM		// Swaps the case of every letter.
+};
+
+// The instructions the kernels are run with.
+enum kernel_isa
+{
+	ISA_SCALAR,
+	ISA_SSE2,
+	ISA_AVX2
+};
+
+// The byte the search counts.
+const char KERNEL_NEEDLE = 'a';
+
+// The kernels picked with -K.
+extern int read_kernel;
+extern int write_kernel;
+
+bool kernel_parse(const char *spec);
+bool kernel_use_isa(const char *name);
+void kernel_setup();
+uint64_t kernel_read(const char *data, size_t len);
+void kernel_write(char *data, size_t len, long seq);
+const char *kernel_read_name();
+const char *kernel_write_name();
+const char *kernel_isa_name();
+
+#endif
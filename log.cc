@@ -0,0 +1,379 @@
+/**************************************************************************
+
+Reader/Writer Problem - Asynchronous Logging
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Keeps printf and the terminal out of the critical
+		sections. Each thread writes fixed-size binary records
+		into its own single-producer ring without locking. A
+		drainer thread takes everything that is waiting, sorts it
+		by time, formats it and writes it with one fwrite().
+		A thread whose ring is full drops the record rather than
+		wait.
+
+		The rings live in shared memory, so readers and writers
+		forked as processes log into them too, and the drainer
+		in the parent prints what they log.
+
+**************************************************************************/
+#include <string.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <atomic>
+#include <new>
+#include "log.h"
+#include "rw.h"
+#include "shm.h"
+
+// Records each thread's ring holds. Must be a power of two.
+const unsigned LOG_RING_SIZE = 1024;
+
+// Most records the drainer prints in one write.
+const int LOG_BATCH = 4096;
+
+struct alignas(64) log_ring
+{
+	std::atomic<unsigned> head;			// Next record the thread fills.
+	alignas(64) std::atomic<unsigned> tail;		// Next record the drainer takes.
+	alignas(64) log_record recs[LOG_RING_SIZE];
+};
+
+bool log_quiet = false;
+
+// Set once log_start() has started the drainer.
+bool log_running = false;
+
+// The counters every thread logging shares.
+struct log_state
+{
+	std::atomic<int> next_ring;	// Next ring to give a thread.
+	std::atomic<long> dropped;	// Records dropped because a ring was
+					// full, or there was no ring left.
+};
+
+log_ring *rings;
+int nrings;
+log_state *state;
+thread_local log_ring *my_ring;
+
+pthread_t drainer;
+std::atomic<bool> log_done;
+
+// The drainer's batch, and the text it formats it into.
+log_record batch[LOG_BATCH];
+char out[LOG_BATCH * (LOG_TEXT + 64)];
+
+/**************************************************************************
+
+Function:	by_time()
+
+Use:		Orders two records by time, for qsort().
+
+Arguments:	1. *a: The first record.
+		2. *b: The second record.
+
+Returns:	Less than, equal to or greater than 0 as a comes before,
+		with or after b.
+
+**************************************************************************/
+
+int by_time(const void *a, const void *b)
+{
+	uint64_t x = ((const log_record *) a)->ns;
+	uint64_t y = ((const log_record *) b)->ns;
+
+	return x < y ? -1 : x > y;
+}
+
+/**************************************************************************
+
+Function:	format_record()
+
+Use:		Formats a record the way the threads used to print it.
+
+Arguments:	1. *buf: Where to put the text.
+		2. size: The room in buf.
+		3. *r: The record.
+
+Returns:	The length of the text.
+
+**************************************************************************/
+
+int format_record(char *buf, size_t size, const log_record *r)
+{
+	switch (r->event)
+	{
+	case LOG_READ_COUNT_INC:
+		return snprintf(buf,size,"read_count increments to: %ld.\n",r->value);
+	case LOG_READ_COUNT_DEC:
+		return snprintf(buf,size,"read_count decrements to: %ld.\n",r->value);
+	case LOG_READING:
+		return snprintf(buf,size,"reader %ld is reading ... content : %s\n",r->id,r->text);
+	case LOG_WRITING:
+		return snprintf(buf,size,"writer %ld is writing ...\n",r->id);
+	case LOG_READER_EXIT:
+		return snprintf(buf,size,"reader %ld is exiting ...\n",r->id);
+	case LOG_WRITER_EXIT:
+		return snprintf(buf,size,"writer %ld is exiting ...\n",r->id);
+	}
+
+	return 0;
+}
+
+/**************************************************************************
+
+Function:	drain()
+
+Use:		Takes every waiting record, up to a batch, and prints
+		them in time order.
+
+Arguments:	None.
+
+Returns:	The number of records printed.
+
+**************************************************************************/
+
+int drain()
+{
+	int count = 0;
+
+	// Take what is waiting in each ring.
+	for (int i = 0; i < nrings && count < LOG_BATCH; i++)
+	{
+		log_ring *ring = &rings[i];
+		unsigned tail = ring->tail.load(std::memory_order_relaxed);
+		unsigned head = ring->head.load(std::memory_order_acquire);
+
+		while (tail != head && count < LOG_BATCH)
+			batch[count++] = ring->recs[tail++ % LOG_RING_SIZE];
+
+		// Give the slots back to the thread.
+		ring->tail.store(tail, std::memory_order_release);
+	}
+
+	if (count == 0)
+		return 0;
+
+	// Put the batch in time order, format it and write it at once.
+	qsort(batch, count, sizeof(log_record), by_time);
+	size_t len = 0;
+	for (int i = 0; i < count; i++)
+		len += format_record(out + len, sizeof(out) - len, &batch[i]);
+	fwrite(out, 1, len, stdout);
+	fflush(stdout);
+
+	return count;
+}
+
+/**************************************************************************
+
+Function:	drainer_thread()
+
+Use:		The drainer thread. It prints records until log_stop()
+		is called and the rings are empty.
+
+Arguments:	1. *param: Unused.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void *drainer_thread(void *param)
+{
+	for (;;)
+	{
+		// Check for the stop before draining, so that anything
+		// logged before the stop is printed.
+		bool done = log_done.load();
+
+		// When there is nothing to print, stop or wait a little.
+		if (drain() == 0)
+		{
+			if (done)
+				break;
+			usleep(1000);
+		}
+	}
+
+	pthread_exit(0);
+}
+
+/**************************************************************************
+
+Function:	lock_stdout()
+
+Use:		Runs before a fork(). It waits for the drainer to finish
+		with stdout and empties it, so the child doesn't start
+		with stdout locked, or print the parent's output again
+		when it exits.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void lock_stdout()
+{
+	flockfile(stdout);
+	fflush(stdout);
+}
+
+/**************************************************************************
+
+Function:	unlock_stdout()
+
+Use:		Runs after a fork(), in the parent and the child.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void unlock_stdout()
+{
+	funlockfile(stdout);
+}
+
+/**************************************************************************
+
+Function:	log_start()
+
+Use:		Gives every thread a ring and starts the drainer, unless
+		logging is off.
+
+Arguments:	1. nthreads: The number of threads that will log.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void log_start(int nthreads)
+{
+	static bool forks_handled = false;
+
+	if (log_quiet)
+		return;
+
+	// Allocate the rings and counters where every thread can see them.
+	nrings = nthreads;
+	rings = (log_ring *) shared_alloc(nrings * sizeof(log_ring));
+	for (int i = 0; i < nrings; i++)
+		new (&rings[i]) log_ring();
+	state = new (shared_alloc(sizeof(log_state))) log_state();
+
+	// Keep the drainer's stdout out of the way of fork().
+	if (!forks_handled)
+	{
+		pthread_atfork(lock_stdout, unlock_stdout, unlock_stdout);
+		forks_handled = true;
+	}
+
+	// Start the drainer.
+	if (pthread_create(&drainer, NULL, drainer_thread, NULL) != 0)
+	{
+		fprintf(stderr,"pthread_create(): log drainer error - %s.\n",strerror(errno));
+		exit(-1);
+	}
+
+	log_running = true;
+}
+
+/**************************************************************************
+
+Function:	log_event()
+
+Use:		Logs an event from the calling thread. It never blocks.
+
+Arguments:	1. event: What happened.
+		2. id: The reader or writer's id.
+		3. value: A number that goes with the event. When there
+		   is text, it is the text's length.
+		4. *text: Text that goes with the event, or NULL. It
+		   doesn't need to be terminated.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void log_event(int event, long id, long value, const char *text)
+{
+	if (!log_running)
+		return;
+
+	// Give the thread a ring the first time it logs.
+	if (my_ring == NULL)
+	{
+		int i = state->next_ring.fetch_add(1);
+		if (i >= nrings)
+		{
+			state->dropped++;
+			return;
+		}
+		my_ring = &rings[i];
+	}
+
+	// Drop the record if the ring is full.
+	unsigned head = my_ring->head.load(std::memory_order_relaxed);
+	if (head - my_ring->tail.load(std::memory_order_acquire) == LOG_RING_SIZE)
+	{
+		state->dropped++;
+		return;
+	}
+
+	// Fill in the record, then hand it to the drainer.
+	log_record *r = &my_ring->recs[head % LOG_RING_SIZE];
+	r->ns = now_ns();
+	r->event = event;
+	r->id = id;
+	r->value = value;
+	r->text[0] = '\0';
+	if (text != NULL)
+	{
+		size_t len = value < LOG_TEXT - 1 ? value : LOG_TEXT - 1;
+		memcpy(r->text, text, len);
+		r->text[len] = '\0';
+	}
+	my_ring->head.store(head + 1, std::memory_order_release);
+}
+
+/**************************************************************************
+
+Function:	log_stop()
+
+Use:		Prints whatever is left and stops the drainer. Every
+		thread that logs must be done first.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void log_stop()
+{
+	if (!log_running)
+		return;
+
+	// Tell the drainer to finish, and wait for it.
+	log_done = true;
+	if (pthread_join(drainer, NULL) != 0)
+	{
+		fprintf(stderr,"pthread_join(): log drainer error - %s.\n",strerror(errno));
+		exit(-1);
+	}
+	log_running = false;
+
+	// Say if anything was lost.
+	if (state->dropped > 0)
+		printf("log: %ld records dropped.\n",state->dropped.load());
+
+	shared_free(rings);
+	shared_free(state);
+}
@@ -0,0 +1,49 @@
+/**************************************************************************
+
+Reader/Writer Problem - Asynchronous Logging
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Declares the logger the reader and writer threads use
+		instead of printf. Each thread writes fixed-size records
+		into its own ring, and a drainer thread prints them.
+
+**************************************************************************/
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+
+// What a record says happened.
+enum log_event
+{
+	LOG_READ_COUNT_INC,	// value: read_count after the increment.
+	LOG_READ_COUNT_DEC,	// value: read_count after the decrement.
+	LOG_READING,		// id: reader, text: what it read, value: its length.
+	LOG_WRITING,		// id: writer.
+	LOG_READER_EXIT,	// id: reader.
+	LOG_WRITER_EXIT		// id: writer.
+};
+
+// Longest text a record keeps, including the terminator. Longer text
+// is cut short.
+const int LOG_TEXT = 64;
+
+struct log_record
+{
+	uint64_t ns;		// When it happened.
+	int event;
+	long id;
+	long value;
+	char text[LOG_TEXT];
+};
+
+// Logging is off when set, as it is in benchmark mode.
+extern bool log_quiet;
+
+void log_start(int nthreads);
+void log_event(int event, long id, long value, const char *text);
+void log_stop();
+
+#endif
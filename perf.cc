@@ -0,0 +1,180 @@
+/**************************************************************************
+
+Reader/Writer Problem - Performance Counters
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Counts what each reader and writer costs the machine.
+		Each thread opens its own counters with
+		perf_event_open() when its loop starts and reads them
+		when it ends, along with its CPU time from getrusage().
+		Events are counted in the kernel too when allowed, and
+		only in user space when perf_event_paranoid says no.
+		An event that isn't there, as in most virtual machines,
+		is left out. Counters that had to share the hardware
+		are scaled by the time they ran.
+
+**************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "perf.h"
+
+bool perf_on = false;
+unsigned long perf_hitm = 0;
+
+// The type and config of each event.
+const struct
+{
+	const char *name;
+	unsigned type;
+	unsigned long config;
+} perf_events[PERF_EVENTS] =
+{
+	{ "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ "LLC misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+	{ "L1D misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+	  (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+	{ "HITM loads", PERF_TYPE_RAW, 0 },
+	{ "context switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+	{ "migrations", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS },
+};
+
+/**************************************************************************
+
+Function:	open_event()
+
+Use:		Opens a counter for the calling thread on any CPU. It
+		starts stopped.
+
+Arguments:	1. event: The event.
+
+Returns:	The counter, or -1 if the event can't be counted.
+
+**************************************************************************/
+
+int open_event(int event)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = perf_events[event].type;
+	attr.config = event == PERF_HITM ? perf_hitm : perf_events[event].config;
+	attr.disabled = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	// Without a raw code, there is no HITM event.
+	if (event == PERF_HITM && perf_hitm == 0)
+		return -1;
+
+	// Count in the kernel too, or only in user space if that isn't
+	// allowed.
+	int fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+	if (fd < 0 && (errno == EACCES || errno == EPERM))
+	{
+		attr.exclude_kernel = 1;
+		fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+	}
+
+	return fd;
+}
+
+/**************************************************************************
+
+Function:	perf_begin()
+
+Use:		Opens and starts the calling thread's counters, and
+		notes its CPU time so far.
+
+Arguments:	1. *g: Where to keep the counters.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void perf_begin(perf_group *g)
+{
+	for (int i = 0; i < PERF_EVENTS; i++)
+	{
+		g->fds[i] = open_event(i);
+		if (g->fds[i] >= 0)
+			ioctl(g->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+
+	if (getrusage(RUSAGE_THREAD, &g->start) != 0)
+	{
+		fprintf(stderr,"getrusage(): %s.\n",strerror(errno));
+		exit(-1);
+	}
+}
+
+/**************************************************************************
+
+Function:	perf_end()
+
+Use:		Stops and reads the calling thread's counters, closes
+		them, and works out the CPU time it used.
+
+Arguments:	1. *g: The counters.
+		2. *into: Where to put what was counted.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void perf_end(perf_group *g, perf_counts *into)
+{
+	struct rusage end;
+
+	if (getrusage(RUSAGE_THREAD, &end) != 0)
+	{
+		fprintf(stderr,"getrusage(): %s.\n",strerror(errno));
+		exit(-1);
+	}
+
+	for (int i = 0; i < PERF_EVENTS; i++)
+	{
+		// The count, then how long it was on and how long it ran.
+		unsigned long long data[3];
+
+		into->values[i] = -1;
+		if (g->fds[i] < 0)
+			continue;
+		ioctl(g->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+		if (read(g->fds[i], data, sizeof(data)) == sizeof(data) && data[2] > 0)
+			into->values[i] = (long) ((double) data[0] * data[1] / data[2]);
+		close(g->fds[i]);
+	}
+
+	// Add up the user and system time.
+	into->cpu_secs = (end.ru_utime.tv_sec - g->start.ru_utime.tv_sec) +
+			 (end.ru_utime.tv_usec - g->start.ru_utime.tv_usec) / 1e6 +
+			 (end.ru_stime.tv_sec - g->start.ru_stime.tv_sec) +
+			 (end.ru_stime.tv_usec - g->start.ru_stime.tv_usec) / 1e6;
+}
+
+/**************************************************************************
+
+Function:	perf_name()
+
+Use:		Names an event.
+
+Arguments:	1. event: The event.
+
+Returns:	Its name.
+
+**************************************************************************/
+
+const char *perf_name(int event)
+{
+	return perf_events[event].name;
+}
@@ -0,0 +1,58 @@
+/**************************************************************************
+
+Reader/Writer Problem - Performance Counters
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Declares the per-thread counters that are read around
+		the reader and writer loops: hardware events from
+		perf_event_open() and CPU time from getrusage().
+
+**************************************************************************/
+#ifndef PERF_H
+#define PERF_H
+
+#include <sys/resource.h>
+
+// The events counted.
+enum perf_kind
+{
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_LLC_MISSES,	// Last level cache misses.
+	PERF_L1D_MISSES,	// L1 data cache read misses.
+	PERF_HITM,		// Loads that hit a line modified in another
+				// core's cache, from the raw event given
+				// with -E.
+	PERF_CSWITCHES,
+	PERF_MIGRATIONS,
+	PERF_EVENTS
+};
+
+// What one thread counted. An event the kernel or processor doesn't
+// have stays at -1.
+struct perf_counts
+{
+	long values[PERF_EVENTS];
+	double cpu_secs;	// User and system time.
+};
+
+// The counters a thread has open.
+struct perf_group
+{
+	int fds[PERF_EVENTS];
+	struct rusage start;
+};
+
+// Count events when set, with -H.
+extern bool perf_on;
+
+// The raw event code for HITM loads on this processor, or 0.
+extern unsigned long perf_hitm;
+
+void perf_begin(perf_group *g);
+void perf_end(perf_group *g, perf_counts *into);
+const char *perf_name(int event);
+
+#endif
@@ -0,0 +1,382 @@
+/**************************************************************************
+
+Reader/Writer Problem - Thread Placement
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Pins readers and writers to CPUs, so runs are placed the
+		same way every time. A list is made of CPU numbers and
+		ranges ("0-3,8"), whole NUMA nodes ("node1"), or "spread",
+		which takes one CPU from each node in turn. The nodes and
+		their CPUs are read from sysfs, so no NUMA library is
+		needed.
+
+**************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include "place.h"
+
+// Where the kernel lists the online CPUs and nodes.
+const char *CPU_ONLINE = "/sys/devices/system/cpu/online";
+const char *NODE_ONLINE = "/sys/devices/system/node/online";
+
+/**************************************************************************
+
+Function:	add_cpu()
+
+Use:		Adds a CPU to the end of a list.
+
+Arguments:	1. *list: The list.
+		2. cpu: The CPU.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void add_cpu(cpu_list *list, int cpu)
+{
+	// Make room for one more.
+	int *cpus = (int *) realloc(list->cpus, (list->count + 1) * sizeof(int));
+	if (cpus == NULL)
+	{
+		fprintf(stderr,"realloc(): cpu list - %s.\n",strerror(errno));
+		exit(-1);
+	}
+
+	list->cpus = cpus;
+	list->cpus[list->count++] = cpu;
+}
+
+/**************************************************************************
+
+Function:	add_ranges()
+
+Use:		Adds the numbers in a list of ranges, such as "0-3,8",
+		the way the kernel writes them.
+
+Arguments:	1. *text: The ranges.
+		2. *list: Where to add them.
+
+Returns:	false if the text isn't a list of ranges, true otherwise.
+
+**************************************************************************/
+
+bool add_ranges(const char *text, cpu_list *list)
+{
+	const char *p = text;
+
+	while (*p != '\0' && *p != '\n')
+	{
+		char *end;
+
+		// Read the first number, and the last, if there is one.
+		long first = strtol(p, &end, 10);
+		if (end == p || first < 0 || first >= CPU_SETSIZE)
+			return false;
+		long last = first;
+		if (*end == '-')
+		{
+			p = end + 1;
+			last = strtol(p, &end, 10);
+			if (end == p || last < first || last >= CPU_SETSIZE)
+				return false;
+		}
+
+		for (long i = first; i <= last; i++)
+			add_cpu(list, (int) i);
+
+		// Move past the comma.
+		p = end;
+		if (*p == ',')
+			p++;
+		else if (*p != '\0' && *p != '\n')
+			return false;
+	}
+
+	return true;
+}
+
+/**************************************************************************
+
+Function:	read_ranges()
+
+Use:		Reads a list of ranges from a sysfs file.
+
+Arguments:	1. *path: The file.
+		2. *list: Where to add them.
+
+Returns:	false if the file can't be read, true otherwise.
+
+**************************************************************************/
+
+bool read_ranges(const char *path, cpu_list *list)
+{
+	char text[4096];
+
+	FILE *f = fopen(path, "r");
+	if (f == NULL)
+		return false;
+	bool ok = fgets(text, sizeof(text), f) != NULL && add_ranges(text, list);
+	fclose(f);
+
+	return ok;
+}
+
+/**************************************************************************
+
+Function:	node_cpus()
+
+Use:		Adds a NUMA node's CPUs to a list.
+
+Arguments:	1. node: The node.
+		2. *list: Where to add them.
+
+Returns:	false if there is no such node, true otherwise.
+
+**************************************************************************/
+
+bool node_cpus(int node, cpu_list *list)
+{
+	char path[128];
+
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+	return read_ranges(path, list);
+}
+
+/**************************************************************************
+
+Function:	place_nodes()
+
+Use:		Counts the NUMA nodes. A kernel without NUMA has one.
+
+Arguments:	None.
+
+Returns:	The number of nodes.
+
+**************************************************************************/
+
+int place_nodes()
+{
+	cpu_list nodes = {};
+
+	if (!read_ranges(NODE_ONLINE, &nodes) || nodes.count == 0)
+	{
+		place_free(&nodes);
+		return 1;
+	}
+
+	// Nodes are numbered from 0, and there may be gaps.
+	int count = nodes.cpus[nodes.count - 1] + 1;
+	place_free(&nodes);
+	return count;
+}
+
+/**************************************************************************
+
+Function:	add_spread()
+
+Use:		Adds every online CPU, taking one from each node in
+		turn, so consecutive threads land on different nodes.
+
+Arguments:	1. *list: Where to add them.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void add_spread(cpu_list *list)
+{
+	int nodes = place_nodes();
+	cpu_list *per_node = (cpu_list *) calloc(nodes, sizeof(cpu_list));
+	if (per_node == NULL)
+	{
+		fprintf(stderr,"calloc(): node cpu lists - %s.\n",strerror(errno));
+		exit(-1);
+	}
+
+	// Without NUMA, every online CPU is on node 0.
+	int longest = 0;
+	for (int n = 0; n < nodes; n++)
+	{
+		if (!node_cpus(n, &per_node[n]) && n == 0)
+			read_ranges(CPU_ONLINE, &per_node[n]);
+		if (per_node[n].count > longest)
+			longest = per_node[n].count;
+	}
+
+	// Deal the CPUs out a node at a time.
+	for (int i = 0; i < longest; i++)
+		for (int n = 0; n < nodes; n++)
+			if (i < per_node[n].count)
+				add_cpu(list, per_node[n].cpus[i]);
+
+	for (int n = 0; n < nodes; n++)
+		place_free(&per_node[n]);
+	free(per_node);
+}
+
+/**************************************************************************
+
+Function:	place_parse()
+
+Use:		Builds a CPU list from what was given on the command
+		line: CPU numbers and ranges, and "nodeN" for every CPU
+		of node N, separated by commas, or "spread". Every CPU
+		must be online.
+
+Arguments:	1. *spec: What was given.
+		2. *list: The list to build.
+
+Returns:	false if spec isn't a list of online CPUs, true
+		otherwise.
+
+**************************************************************************/
+
+bool place_parse(const char *spec, cpu_list *list)
+{
+	place_free(list);
+	list->spec = spec;
+
+	if (strcmp(spec, "spread") == 0)
+		add_spread(list);
+	else
+	{
+		// Go through the items one at a time.
+		char *copy = strdup(spec);
+		char *save;
+		for (char *item = strtok_r(copy, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save))
+		{
+			bool ok;
+			if (strncmp(item, "node", 4) == 0)
+			{
+				char *end;
+				long node = strtol(item + 4, &end, 10);
+				ok = end != item + 4 && *end == '\0' && node >= 0 && node_cpus((int) node, list);
+			}
+			else
+				ok = add_ranges(item, list);
+
+			if (!ok)
+			{
+				free(copy);
+				return false;
+			}
+		}
+		free(copy);
+	}
+
+	// Make sure every CPU can be used.
+	cpu_list online = {};
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (read_ranges(CPU_ONLINE, &online))
+		for (int i = 0; i < online.count; i++)
+			CPU_SET(online.cpus[i], &set);
+	else
+		CPU_SET(0, &set);
+	place_free(&online);
+
+	for (int i = 0; i < list->count; i++)
+		if (!CPU_ISSET(list->cpus[i], &set))
+			return false;
+
+	return list->count > 0;
+}
+
+/**************************************************************************
+
+Function:	place_attr()
+
+Use:		Sets a thread's attributes so it starts on its CPU, or
+		anywhere when its kind of thread isn't pinned.
+
+Arguments:	1. *attr: The thread's attributes.
+		2. *list: The CPUs for its kind of thread.
+		3. id: The thread's id.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void place_attr(pthread_attr_t *attr, const cpu_list *list, long id)
+{
+	cpu_set_t set;
+
+	// Without a list, the thread may run wherever the program may,
+	// whatever the last thread was pinned to.
+	if (list->count == 0)
+	{
+		if (sched_getaffinity(0, sizeof(set), &set) != 0)
+		{
+			fprintf(stderr,"sched_getaffinity(): %s.\n",strerror(errno));
+			exit(-1);
+		}
+	}
+	else
+	{
+		CPU_ZERO(&set);
+		CPU_SET(list->cpus[id % list->count], &set);
+	}
+
+	// The error comes back rather than in errno.
+	int err = pthread_attr_setaffinity_np(attr, sizeof(set), &set);
+	if (err != 0)
+	{
+		fprintf(stderr,"pthread_attr_setaffinity_np(): %s.\n",strerror(err));
+		exit(-1);
+	}
+}
+
+/**************************************************************************
+
+Function:	place_self()
+
+Use:		Moves the calling process to its CPU, for readers and
+		writers that are processes.
+
+Arguments:	1. *list: The CPUs for its kind of process.
+		2. id: The process's reader or writer id.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void place_self(const cpu_list *list, long id)
+{
+	if (list->count == 0)
+		return;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(list->cpus[id % list->count], &set);
+
+	if (sched_setaffinity(0, sizeof(set), &set) != 0)
+	{
+		fprintf(stderr,"sched_setaffinity(): %s.\n",strerror(errno));
+		exit(-1);
+	}
+}
+
+/**************************************************************************
+
+Function:	place_free()
+
+Use:		Empties a CPU list.
+
+Arguments:	1. *list: The list.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void place_free(cpu_list *list)
+{
+	free(list->cpus);
+	list->cpus = NULL;
+	list->count = 0;
+}
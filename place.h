@@ -0,0 +1,32 @@
+/**************************************************************************
+
+Reader/Writer Problem - Thread Placement
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Declares the CPU lists readers and writers are pinned to,
+		given as CPU numbers, NUMA nodes or spread over the nodes.
+
+**************************************************************************/
+#ifndef PLACE_H
+#define PLACE_H
+
+#include <pthread.h>
+
+// The CPUs a kind of thread is pinned to. Thread i runs on
+// cpus[i % count].
+struct cpu_list
+{
+	const char *spec;	// What was given, for the header.
+	int *cpus;
+	int count;		// 0 when the kernel places the threads.
+};
+
+int place_nodes();
+bool place_parse(const char *spec, cpu_list *list);
+void place_attr(pthread_attr_t *attr, const cpu_list *list, long id);
+void place_self(const cpu_list *list, long id);
+void place_free(cpu_list *list);
+
+#endif
@@ -0,0 +1,3095 @@
+/**************************************************************************
+
+Reader/Writer Problem - Lock Policies
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	The lock policies the readers and writers can run under.
+
+		reader-pref:	Readers have priority. The first reader
+				locks out the writers and the last one
+				lets them back in.
+		writer-pref:	Writers have priority. The first waiting
+				writer locks out new readers until the
+				last writer is done.
+		alternate:	Readers and writers take strict turns.
+		phase-fair:	Ticket lock where reader and writer
+				phases alternate, so neither side starves.
+		seqlock:	Writers bump a sequence number around
+				each write, and readers copy the string
+				without locking and retry if it changed.
+		big-reader:	Each reader thread counts itself in its
+				own cache line instead of a shared
+				read_count, and writers drain every slot.
+		rcu:		Writers publish a new copy of the string
+				and readers never wait. Old copies are
+				freed by epoch-based reclamation.
+		futex:		One atomic word holds the reader count and
+				a writer bit. Taking and releasing it is
+				a single atomic operation, and only a
+				thread that has to wait makes a system
+				call, to sleep on the word with futex().
+		cohort:		NUMA-aware. Each node counts its own readers,
+				and writers take a cohort lock: a global
+				ticket lock and a ticket lock per node. A
+				writer that is done passes the lock to the
+				next writer on its node, up to COHORT_BATCH
+				times in a row, before the global lock goes
+				to another node. Readers that had to wait
+				get in when the batch ends, before the
+				next writer. A reader then waits at most
+				one batch, but the writers' batches end
+				sooner under a steady read load.
+		deadline:	Readers have priority, until a writer has
+				used half the time to its deadline. Then
+				it is boosted: new readers wait until it
+				has been through. Built on a mutex and
+				two condition variables.
+		pthread-rwlock:	The C library's pthread_rwlock_t.
+		shared-mutex:	The C++ library's std::shared_mutex.
+
+		With -S, a thread that finds a semaphore or the futex
+		word taken spins for a while before it sleeps. How long
+		it spins adapts to how long the lock was held the last
+		times spinning got it.
+
+		reader-pref, writer-pref, deadline and pthread-rwlock
+		can also be taken by a deadline, with sem_timedwait()
+		and the like, giving up if it passes. With a deadline
+		that has already passed they only try once.
+
+**************************************************************************/
+#include <string.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <atomic>
+#include <new>
+#include <shared_mutex>
+#include "policy.h"
+#include "rw.h"
+#include "log.h"
+#include "shm.h"
+#include "trace.h"
+#include "shared_resource.h"
+
+// Phase-fair. The low bits of rin hold the writer present and phase
+// bits, and the upper bits count readers.
+const unsigned PF_PHID = 0x1;
+const unsigned PF_PRES = 0x2;
+const unsigned PF_WBITS = 0x3;
+const unsigned PF_RINC = 0x100;
+
+// Futex. The low bits of the word count readers.
+const unsigned FX_WRITER = 0x40000000;		// A writer holds the lock.
+const unsigned FX_WAITING = 0x80000000;		// Someone is sleeping on the word.
+
+// Cohort. Nodes past COHORT_NODES share a slot, and a node passes the
+// lock among its writers at most COHORT_BATCH times in a row.
+const int COHORT_NODES = 8;
+const int COHORT_BATCH = 64;
+
+// A node's part of the cohort lock, in its own cache line, so readers
+// and writers on one node never touch another node's lines.
+struct alignas(64) cohort_node
+{
+	std::atomic<long> readers;		// Readers in on this node.
+	std::atomic<unsigned> next;		// Local ticket lock.
+	std::atomic<unsigned> serving;
+	bool global;				// The node's writers hold the
+						// global lock.
+	int batch;				// Handoffs in a row on this node.
+};
+
+// The node the calling thread runs on.
+thread_local int my_node = -1;
+
+// Spin-then-park. The budget never drops below SPIN_MIN, and moves an
+// eighth of the way to its target each time.
+const int SPIN_MIN = 16;
+const int SPIN_SHIFT = 3;
+
+// Most times a contended acquire spins before it sleeps, or 0 to
+// sleep at once.
+int spin_max = 0;
+
+// Per-thread slots for the big-reader and RCU policies. Each slot sits
+// in its own cache line, so threads on different cores never write the
+// same line.
+struct alignas(64) thread_slot
+{
+	std::atomic<long> value;
+};
+int nslots;
+thread_local int my_slot = -1;
+
+// RCU. A reader's slot holds the epoch it started reading in, or 0 when
+// it isn't reading. Retired copies wait in limbo, tagged with the last
+// epoch they were visible in.
+struct retired
+{
+	void *ptr;
+	unsigned long epoch;
+	retired *next;
+};
+
+// A semaphore for the locks from shared_resource.h. It waits with
+// wait_sem(), so it spins, is timed and is traced like the rest.
+struct policy_sem
+{
+	sem_t sem;
+	const char *name;
+
+	void init(unsigned value, bool pshared, const char *sem_name);
+	void wait();
+	bool wait_until(uint64_t deadline);
+	void post();
+	void destroy();
+};
+
+// Logs every change to read_count for those locks.
+struct policy_events
+{
+	static void read_count(int count, bool up)
+	{
+		log_event(up ? LOG_READ_COUNT_INC : LOG_READ_COUNT_DEC,0,count,NULL);
+	}
+};
+
+// Everything the policies change while the readers and writers run. It
+// lives in shared memory, so it works the same whether they are threads
+// or processes. Each shard of the resource has its own.
+struct policy_state
+{
+	// Reader priority, writer priority and alternating, the locks from
+	// shared_resource.h.
+	reader_pref_lock<policy_sem, policy_events> rp;
+	writer_pref_lock<policy_sem, policy_events> wp;
+	alternate_lock<policy_sem, policy_events> alt;
+
+	// Phase-fair.
+	std::atomic<unsigned> pf_rin;
+	std::atomic<unsigned> pf_rout;
+	std::atomic<unsigned> pf_win;
+	std::atomic<unsigned> pf_wout;
+
+	// Seqlock. The sequence number is odd while a writer is writing.
+	sem_t seq_sem;
+	std::atomic<unsigned> seq;
+
+	// Next free thread slot. Only the first shard's is used, so a
+	// thread has the same slot in every shard.
+	std::atomic<int> next_slot;
+
+	// Big-reader and RCU.
+	thread_slot *slots;
+
+	// Big-reader.
+	sem_t br_sem;
+	std::atomic<bool> br_writer;
+
+	// RCU.
+	sem_t rcu_sem;
+	std::atomic<unsigned long> rcu_epoch;
+	retired *limbo;
+
+	// Futex, and the system calls it has made.
+	std::atomic<unsigned> fx_word;
+	std::atomic<long> fx_syscalls;
+
+	// Cohort.
+	cohort_node co_nodes[COHORT_NODES];
+	std::atomic<unsigned> co_next;		// Global ticket lock.
+	std::atomic<unsigned> co_serving;
+	std::atomic<bool> co_writer;		// A node's writers hold it.
+	std::atomic<long> co_waiting;		// Readers kept out by writers.
+	std::atomic<bool> co_reader_turn;	// The waiting readers go next.
+
+	// Deadline. Readers wait on dl_readers while a writer writes or
+	// is boosted, and writers wait on dl_writers.
+	pthread_mutex_t dl_mutex;
+	pthread_cond_t dl_readers;
+	pthread_cond_t dl_writers;
+	int dl_reading;
+	bool dl_writing;
+	int dl_boosted;				// Writers boosted and waiting.
+	long dl_boosts;				// Times a writer was boosted.
+
+	// Library locks.
+	pthread_rwlock_t prw_lock;
+	std::shared_mutex sm_lock;
+
+	// Spin-then-park: how long to spin, and how contended acquires
+	// ended.
+	std::atomic<int> spin_budget;
+	std::atomic<long> spin_wins;
+	std::atomic<long> spin_parks;
+};
+policy_state *states;
+int nstates;
+
+// The state of the shard the calling thread is working on.
+thread_local policy_state *ps;
+
+const lock_policy *policy;
+
+/**************************************************************************
+
+Function:	init_sem()
+
+Use:		Initializes a semaphore. It is shared between processes
+		when the readers and writers are processes.
+
+Arguments:	1. *sem: The semaphore.
+		2. value: Its starting value.
+		3. *name: The semaphore's name, for errors.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void init_sem(sem_t *sem, unsigned value, const char *name)
+{
+	// Try to initialize the semaphore. If it fails, print why.
+	if(sem_init(sem, process_mode, value) != 0)
+	{
+		fprintf(stderr,"sem_init(): %s semaphore error - %s.\n",name,strerror(errno));
+		exit(-1);
+	}
+}
+
+/**************************************************************************
+
+Function:	cpu_relax()
+
+Use:		Tells the processor the thread is spinning, so it can
+		give the core to its sibling and doesn't mispredict the
+		loop's exit.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	asm volatile("yield");
+#endif
+}
+
+/**************************************************************************
+
+Function:	spin_adapt()
+
+Use:		Learns from how a spin ended. When spinning got the lock
+		after n spins, the holder let it go about n spins in, so
+		the budget moves toward twice that. When it didn't, the
+		lock is held too long to spin for, and the budget
+		shrinks.
+
+Arguments:	1. won: Whether spinning got the lock.
+		2. spins: How many times the thread spun.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void spin_adapt(bool won, int spins)
+{
+	int budget = ps->spin_budget.load(std::memory_order_relaxed);
+
+	if (won)
+	{
+		budget += (2 * spins - budget) >> SPIN_SHIFT;
+		ps->spin_wins.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		budget -= budget >> SPIN_SHIFT;
+		ps->spin_parks.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Keep it between the bounds. Racing updates only lose a step.
+	if (budget < SPIN_MIN)
+		budget = SPIN_MIN;
+	if (budget > spin_max)
+		budget = spin_max;
+	ps->spin_budget.store(budget, std::memory_order_relaxed);
+}
+
+/**************************************************************************
+
+Function:	spin_sem()
+
+Use:		Spins on a taken semaphore for the shard's budget,
+		trying to take it without a system call.
+
+Arguments:	1. *sem: The semaphore.
+
+Returns:	true if the thread took the semaphore, false if it has
+		to sleep.
+
+**************************************************************************/
+
+bool spin_sem(sem_t *sem)
+{
+	int budget = ps->spin_budget.load(std::memory_order_relaxed);
+
+	for (int i = 1; i <= budget; i++)
+	{
+		cpu_relax();
+		if (sem_trywait(sem) == 0)
+		{
+			spin_adapt(true, i);
+			return true;
+		}
+	}
+
+	spin_adapt(false, budget);
+	return false;
+}
+
+/**************************************************************************
+
+Function:	spin_word()
+
+Use:		Spins on the futex word for the shard's budget, waiting
+		for the bits that keep the thread out to clear.
+
+Arguments:	1. *word: The futex word.
+		2. busy: The bits that keep the thread out.
+
+Returns:	true if they cleared, false if the thread has to sleep.
+
+**************************************************************************/
+
+bool spin_word(std::atomic<unsigned> *word, unsigned busy)
+{
+	int budget = ps->spin_budget.load(std::memory_order_relaxed);
+
+	for (int i = 1; i <= budget; i++)
+	{
+		cpu_relax();
+		if ((word->load(std::memory_order_relaxed) & busy) == 0)
+		{
+			spin_adapt(true, i);
+			return true;
+		}
+	}
+
+	spin_adapt(false, budget);
+	return false;
+}
+
+/**************************************************************************
+
+Function:	wait_start()
+
+Use:		Notes when a wait for the lock started, if waits are
+		being timed.
+
+Arguments:	None.
+
+Returns:	The time in ns, or 0 if waits aren't timed.
+
+**************************************************************************/
+
+uint64_t wait_start()
+{
+	return wait_hist ? now_ns() : 0;
+}
+
+/**************************************************************************
+
+Function:	wait_done()
+
+Use:		Records a wait for the lock that just ended, as one
+		sample in the thread's wait histogram.
+
+Arguments:	1. start: When the wait started, from wait_start().
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void wait_done(uint64_t start)
+{
+	if (wait_hist)
+		hist_record(wait_hist, now_ns() - start);
+}
+
+/**************************************************************************
+
+Function:	wait_sem()
+
+Use:		Waits on a semaphore. When the thread is traced, so are
+		the start and end of the wait. It isn't timed here: one
+		lock can pass through several semaphores, so the lock
+		times its whole wait with wait_start() and wait_done().
+
+Arguments:	1. *sem: The semaphore.
+		2. *name: The semaphore's name, for errors.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void wait_sem(sem_t *sem, const char *name)
+{
+	if (my_trace)
+		trace_add(TRACE_ATTEMPT, name);
+
+	// Under spin-then-park, take the semaphore if it's free, or spin
+	// for it before sleeping.
+	if (spin_max > 0 && (sem_trywait(sem) == 0 || spin_sem(sem)))
+	{
+		// Got it without sleeping.
+	}
+	// Wait for the semaphore. If it fails, print why.
+	else if(sem_wait(sem) != 0)
+	{
+		fprintf(stderr,"sem_wait(): %s semaphore error - %s.\n",name,strerror(errno));
+		exit(-1);
+	}
+
+	if (my_trace)
+		trace_add(TRACE_ACQUIRE, name);
+}
+
+/**************************************************************************
+
+Function:	post_sem()
+
+Use:		Signals a semaphore, and traces it.
+
+Arguments:	1. *sem: The semaphore.
+		2. *name: The semaphore's name, for errors.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void post_sem(sem_t *sem, const char *name)
+{
+	// Record the post first, so it comes before the wait it ends.
+	if (my_trace)
+		trace_add(TRACE_RELEASE, name);
+
+	// Signal the semaphore. If it fails, print why.
+	if(sem_post(sem) != 0)
+	{
+		fprintf(stderr,"sem_post(): %s semaphore error - %s.\n",name,strerror(errno));
+		exit(-1);
+	}
+}
+
+/**************************************************************************
+
+Function:	abs_time()
+
+Use:		Turns a deadline on the CLOCK_MONOTONIC clock into a time
+		on another clock, for the calls that wait until a time
+		on it.
+
+Arguments:	1. deadline: The deadline, in ns.
+		2. clock: The clock to give it on.
+		3. *ts: Where to put it.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void abs_time(uint64_t deadline, clockid_t clock, struct timespec *ts)
+{
+	uint64_t now = now_ns();
+	uint64_t left = deadline > now ? deadline - now : 0;
+
+	// Add what's left to the clock's own time.
+	clock_gettime(clock, ts);
+	uint64_t at = (uint64_t) ts->tv_sec * 1000000000 + ts->tv_nsec + left;
+	ts->tv_sec = at / 1000000000;
+	ts->tv_nsec = at % 1000000000;
+}
+
+/**************************************************************************
+
+Function:	wait_sem_until()
+
+Use:		Waits on a semaphore until a deadline, with
+		sem_timedwait(). It is traced like wait_sem().
+
+Arguments:	1. *sem: The semaphore.
+		2. *name: The semaphore's name, for errors.
+		3. deadline: When to give up, in ns. If it has passed,
+		             the semaphore is only tried.
+
+Returns:	true if the semaphore was taken, false if the deadline
+		passed.
+
+**************************************************************************/
+
+bool wait_sem_until(sem_t *sem, const char *name, uint64_t deadline)
+{
+	if (my_trace)
+		trace_add(TRACE_ATTEMPT, name);
+
+	// Take it if it's free. Otherwise, wait for it if there's time.
+	int ret = sem_trywait(sem);
+	if (ret != 0 && errno == EAGAIN && deadline > now_ns())
+	{
+		// sem_timedwait() wants the time on CLOCK_REALTIME.
+		struct timespec ts;
+		abs_time(deadline, CLOCK_REALTIME, &ts);
+		while ((ret = sem_timedwait(sem, &ts)) != 0 && errno == EINTR)
+			;
+	}
+
+	// Print why it failed, unless it's because time ran out.
+	if (ret != 0 && errno != EAGAIN && errno != ETIMEDOUT)
+	{
+		fprintf(stderr,"sem_timedwait(): %s semaphore error - %s.\n",name,strerror(errno));
+		exit(-1);
+	}
+	if (ret != 0)
+		return false;
+
+	if (my_trace)
+		trace_add(TRACE_ACQUIRE, name);
+
+	return true;
+}
+
+/**************************************************************************
+
+Function:	destroy_sem()
+
+Use:		Destroys a semaphore.
+
+Arguments:	1. *sem: The semaphore.
+		2. *name: The semaphore's name, for errors.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void destroy_sem(sem_t *sem, const char *name)
+{
+	// Try and destroy the semaphore. If it fails, print why.
+	if(sem_destroy(sem) != 0)
+	{
+		fprintf(stderr,"sem_destroy(): %s semaphore - %s.\n",name,strerror(errno));
+		exit(-1);
+	}
+}
+
+/**************************************************************************
+
+Function:	policy_sem::init()
+
+Use:		Initializes a lock's semaphore.
+
+Arguments:	1. value: Its starting value.
+		2. pshared: Whether processes share it. init_sem()
+		            already knows, from process_mode.
+		3. *sem_name: Its name, for errors and traces.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void policy_sem::init(unsigned value, bool pshared, const char *sem_name)
+{
+	name = sem_name;
+	init_sem(&sem, value, name);
+}
+
+/**************************************************************************
+
+Function:	policy_sem::wait()
+
+Use:		Waits on a lock's semaphore.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void policy_sem::wait()
+{
+	wait_sem(&sem, name);
+}
+
+/**************************************************************************
+
+Function:	policy_sem::wait_until()
+
+Use:		Waits on a lock's semaphore until a deadline.
+
+Arguments:	1. deadline: When to give up, in ns.
+
+Returns:	true if it was taken, false if the deadline passed.
+
+**************************************************************************/
+
+bool policy_sem::wait_until(uint64_t deadline)
+{
+	return wait_sem_until(&sem, name, deadline);
+}
+
+/**************************************************************************
+
+Function:	policy_sem::post()
+
+Use:		Signals a lock's semaphore.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void policy_sem::post()
+{
+	post_sem(&sem, name);
+}
+
+/**************************************************************************
+
+Function:	policy_sem::destroy()
+
+Use:		Destroys a lock's semaphore.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void policy_sem::destroy()
+{
+	destroy_sem(&sem, name);
+}
+
+/**************************************************************************
+
+Function:	release_none()
+
+Use:		The release function for policies that never leave a
+		thread blocked once the others are done.
+
+Arguments:	1. readers: The number of reader threads.
+		2. writers: The number of writer threads.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void release_none(int readers, int writers)
+{
+}
+
+/**************************************************************************
+
+Function:	rp_init()
+
+Use:		Initializes the reader priority policy.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void rp_init()
+{
+	ps->rp.init(process_mode);
+}
+
+/**************************************************************************
+
+Function:	rp_read_lock()
+
+Use:		Enters a read under reader priority. The first reader
+		waits for the writers to finish.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void rp_read_lock()
+{
+	uint64_t start = wait_start();
+
+	ps->rp.read_lock();
+	wait_done(start);
+}
+
+/**************************************************************************
+
+Function:	rp_read_lock_until()
+
+Use:		Enters a read under reader priority by a deadline.
+
+Arguments:	1. deadline: When to give up, in ns.
+
+Returns:	true if the reader got in, false if the deadline passed.
+
+**************************************************************************/
+
+bool rp_read_lock_until(uint64_t deadline)
+{
+	uint64_t start = wait_start();
+
+	// Only a wait that got the lock is recorded.
+	bool got = ps->rp.read_lock_until(deadline);
+	if (got)
+		wait_done(start);
+	return got;
+}
+
+/**************************************************************************
+
+Function:	rp_read_unlock()
+
+Use:		Leaves a read under reader priority. The last reader
+		signals the writers.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void rp_read_unlock()
+{
+	ps->rp.read_unlock();
+}
+
+/**************************************************************************
+
+Function:	rp_write_lock()
+
+Use:		Enters a write under reader priority.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void rp_write_lock()
+{
+	uint64_t start = wait_start();
+
+	ps->rp.write_lock();
+	wait_done(start);
+}
+
+/**************************************************************************
+
+Function:	rp_write_lock_until()
+
+Use:		Enters a write under reader priority by a deadline.
+
+Arguments:	1. deadline: When to give up, in ns.
+
+Returns:	true if the writer got in, false if the deadline passed.
+
+**************************************************************************/
+
+bool rp_write_lock_until(uint64_t deadline)
+{
+	uint64_t start = wait_start();
+
+	// Only a wait that got the lock is recorded.
+	bool got = ps->rp.write_lock_until(deadline);
+	if (got)
+		wait_done(start);
+	return got;
+}
+
+/**************************************************************************
+
+Function:	rp_write_unlock()
+
+Use:		Leaves a write under reader priority.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void rp_write_unlock()
+{
+	ps->rp.write_unlock();
+}
+
+/**************************************************************************
+
+Function:	rp_destroy()
+
+Use:		Cleans up the reader priority policy.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void rp_destroy()
+{
+	ps->rp.destroy();
+}
+
+/**************************************************************************
+
+Function:	wp_init()
+
+Use:		Initializes the writer priority policy.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void wp_init()
+{
+	ps->wp.init(process_mode);
+}
+
+/**************************************************************************
+
+Function:	wp_read_lock()
+
+Use:		Enters a read under writer priority. Readers have to
+		get through try_sem, which a waiting writer holds.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void wp_read_lock()
+{
+	uint64_t start = wait_start();
+
+	ps->wp.read_lock();
+	wait_done(start);
+}
+
+/**************************************************************************
+
+Function:	wp_read_lock_until()
+
+Use:		Enters a read under writer priority by a deadline.
+
+Arguments:	1. deadline: When to give up, in ns.
+
+Returns:	true if the reader got in, false if the deadline passed.
+
+**************************************************************************/
+
+bool wp_read_lock_until(uint64_t deadline)
+{
+	uint64_t start = wait_start();
+
+	// Only a wait that got the lock is recorded.
+	bool got = ps->wp.read_lock_until(deadline);
+	if (got)
+		wait_done(start);
+	return got;
+}
+
+/**************************************************************************
+
+Function:	wp_read_unlock()
+
+Use:		Leaves a read under writer priority.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void wp_read_unlock()
+{
+	ps->wp.read_unlock();
+}
+
+/**************************************************************************
+
+Function:	wp_write_lock()
+
+Use:		Enters a write under writer priority. The first waiting
+		writer shuts out new readers.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void wp_write_lock()
+{
+	uint64_t start = wait_start();
+
+	ps->wp.write_lock();
+	wait_done(start);
+}
+
+/**************************************************************************
+
+Function:	wp_write_lock_until()
+
+Use:		Enters a write under writer priority by a deadline. A
+		writer that runs out of time takes itself out of
+		write_count.
+
+Arguments:	1. deadline: When to give up, in ns.
+
+Returns:	true if the writer got in, false if the deadline passed.
+
+**************************************************************************/
+
+bool wp_write_lock_until(uint64_t deadline)
+{
+	uint64_t start = wait_start();
+
+	// Only a wait that got the lock is recorded.
+	bool got = ps->wp.write_lock_until(deadline);
+	if (got)
+		wait_done(start);
+	return got;
+}
+
+/**************************************************************************
+
+Function:	wp_write_unlock()
+
+Use:		Leaves a write under writer priority. The last writer
+		lets readers back in.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void wp_write_unlock()
+{
+	ps->wp.write_unlock();
+}
+
+/**************************************************************************
+
+Function:	wp_destroy()
+
+Use:		Cleans up the writer priority policy.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void wp_destroy()
+{
+	ps->wp.destroy();
+}
+
+/**************************************************************************
+
+Function:	alt_init()
+
+Use:		Initializes the alternating policy. Readers go first.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void alt_init()
+{
+	ps->alt.init(process_mode);
+}
+
+/**************************************************************************
+
+Function:	alt_read_lock()
+
+Use:		Waits for a reader's turn.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void alt_read_lock()
+{
+	uint64_t start = wait_start();
+
+	ps->alt.read_lock();
+	wait_done(start);
+}
+
+/**************************************************************************
+
+Function:	alt_read_unlock()
+
+Use:		Hands the turn to a writer.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void alt_read_unlock()
+{
+	ps->alt.read_unlock();
+}
+
+/**************************************************************************
+
+Function:	alt_write_lock()
+
+Use:		Waits for a writer's turn.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void alt_write_lock()
+{
+	uint64_t start = wait_start();
+
+	ps->alt.write_lock();
+	wait_done(start);
+}
+
+/**************************************************************************
+
+Function:	alt_write_unlock()
+
+Use:		Hands the turn to a reader.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void alt_write_unlock()
+{
+	ps->alt.write_unlock();
+}
+
+/**************************************************************************
+
+Function:	alt_release()
+
+Use:		Signals every reader and writer once, so that threads
+		waiting for a turn that will never come can exit.
+
+Arguments:	1. readers: The number of reader threads.
+		2. writers: The number of writer threads.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void alt_release(int readers, int writers)
+{
+	ps->alt.release(readers, writers);
+}
+
+/**************************************************************************
+
+Function:	alt_destroy()
+
+Use:		Cleans up the alternating policy.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void alt_destroy()
+{
+	ps->alt.destroy();
+}
+
+/**************************************************************************
+
+Function:	pf_init()
+
+Use:		Initializes the phase-fair ticket lock.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void pf_init()
+{
+	ps->pf_rin = 0;
+	ps->pf_rout = 0;
+	ps->pf_win = 0;
+	ps->pf_wout = 0;
+}
+
+/**************************************************************************
+
+Function:	pf_read_lock()
+
+Use:		Enters a read under the phase-fair lock. If a writer is
+		present, the reader waits for that writer's phase to end.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void pf_read_lock()
+{
+	// Note when the wait started, if waits are being timed.
+	uint64_t start = wait_hist ? now_ns() : 0;
+
+	// Announce the reader and see whether a writer is present.
+	unsigned w = ps->pf_rin.fetch_add(PF_RINC) & PF_WBITS;
+
+	// Wait until the writer bits change, which ends the write phase.
+	if (w != 0)
+		while ((ps->pf_rin.load() & PF_WBITS) == w)
+			sched_yield();
+
+	// Record how long the wait took.
+	if (wait_hist)
+		hist_record(wait_hist, now_ns() - start);
+}
+
+/**************************************************************************
+
+Function:	pf_read_unlock()
+
+Use:		Leaves a read under the phase-fair lock.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void pf_read_unlock()
+{
+	ps->pf_rout.fetch_add(PF_RINC);
+}
+
+/**************************************************************************
+
+Function:	pf_write_lock()
+
+Use:		Enters a write under the phase-fair lock. Writers are
+		served in ticket order, and each one waits only for the
+		readers that came before it.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void pf_write_lock()
+{
+	// Note when the wait started, if waits are being timed.
+	uint64_t start = wait_hist ? now_ns() : 0;
+
+	// Take a ticket and wait for the writers ahead.
+	unsigned ticket = ps->pf_win.fetch_add(1);
+	while (ps->pf_wout.load() != ticket)
+		sched_yield();
+
+	// Block new readers, then wait for the readers already in.
+	unsigned w = PF_PRES | (ticket & PF_PHID);
+	unsigned rticket = ps->pf_rin.fetch_add(w);
+	while (ps->pf_rout.load() != rticket)
+		sched_yield();
+
+	// Record how long the wait took.
+	if (wait_hist)
+		hist_record(wait_hist, now_ns() - start);
+}
+
+/**************************************************************************
+
+Function:	pf_write_unlock()
+
+Use:		Leaves a write under the phase-fair lock. Clearing the
+		writer bits lets the waiting readers in.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void pf_write_unlock()
+{
+	ps->pf_rin.fetch_and(~PF_WBITS);
+	ps->pf_wout.fetch_add(1);
+}
+
+/**************************************************************************
+
+Function:	pf_destroy()
+
+Use:		Cleans up the phase-fair ticket lock.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void pf_destroy()
+{
+}
+
+/**************************************************************************
+
+Function:	sl_init()
+
+Use:		Initializes the seqlock.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void sl_init()
+{
+	init_sem(&ps->seq_sem, 1, "sequence");
+	ps->seq = 0;
+}
+
+/**************************************************************************
+
+Function:	sl_read_begin()
+
+Use:		Starts an optimistic read. Waits until no writer is
+		writing, then returns the sequence number the read has
+		to match.
+
+Arguments:	None.
+
+Returns:	The sequence number.
+
+**************************************************************************/
+
+unsigned sl_read_begin()
+{
+	// Note when the wait started, if waits are being timed.
+	uint64_t start = wait_hist ? now_ns() : 0;
+
+	// Wait for an even sequence number.
+	unsigned s = ps->seq.load(std::memory_order_acquire);
+	while (s & 1)
+	{
+		sched_yield();
+		s = ps->seq.load(std::memory_order_acquire);
+	}
+
+	// Record how long the wait took.
+	if (wait_hist)
+		hist_record(wait_hist, now_ns() - start);
+
+	return s;
+}
+
+/**************************************************************************
+
+Function:	sl_read_retry()
+
+Use:		Ends an optimistic read.
+
+Arguments:	1. s: The sequence number from sl_read_begin().
+
+Returns:	true if a writer got in and the read has to be done
+		again, false if the copy is good.
+
+**************************************************************************/
+
+bool sl_read_retry(unsigned s)
+{
+	// Keep the copy from moving past the second load.
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return ps->seq.load(std::memory_order_relaxed) != s;
+}
+
+/**************************************************************************
+
+Function:	sl_write_lock()
+
+Use:		Enters a write under the seqlock. Writers still exclude
+		each other, and the sequence number goes odd so readers
+		know a write is under way.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void sl_write_lock()
+{
+	// Wait for the other writers, timing it.
+	uint64_t start = wait_start();
+	wait_sem(&ps->seq_sem, "sequence");
+	wait_done(start);
+
+	// Make the sequence number odd before anything is written.
+	ps->seq.store(ps->seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+/**************************************************************************
+
+Function:	sl_write_unlock()
+
+Use:		Leaves a write under the seqlock. The sequence number
+		goes even again, with a new value.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void sl_write_unlock()
+{
+	// Publish the write along with the new sequence number.
+	ps->seq.store(ps->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+	// Let the next writer in.
+	post_sem(&ps->seq_sem, "sequence");
+}
+
+/**************************************************************************
+
+Function:	sl_destroy()
+
+Use:		Cleans up the seqlock.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void sl_destroy()
+{
+	destroy_sem(&ps->seq_sem, "sequence");
+}
+
+/**************************************************************************
+
+Function:	alloc_slots()
+
+Use:		Allocates a cleared slot for every thread that takes
+		the lock, lined up on cache lines.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void alloc_slots()
+{
+	// Allocate the slots where every reader and writer can see them.
+	nslots = num_threads;
+	ps->slots = (thread_slot *) shared_alloc(nslots * sizeof(thread_slot));
+
+	// Clear them.
+	for (int i = 0; i < nslots; i++)
+		new (&ps->slots[i]) thread_slot();
+	ps->next_slot = 0;
+}
+
+/**************************************************************************
+
+Function:	get_slot()
+
+Use:		Finds the calling thread's slot, giving it the next free
+		one the first time it asks.
+
+Arguments:	None.
+
+Returns:	The thread's slot.
+
+**************************************************************************/
+
+thread_slot *get_slot()
+{
+	if (my_slot < 0)
+	{
+		my_slot = states[0].next_slot.fetch_add(1);
+		if (my_slot >= nslots)
+		{
+			fprintf(stderr,"get_slot(): more threads than slots.\n");
+			exit(-1);
+		}
+	}
+
+	return &ps->slots[my_slot];
+}
+
+/**************************************************************************
+
+Function:	br_init()
+
+Use:		Initializes the big-reader lock.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void br_init()
+{
+	init_sem(&ps->br_sem, 1, "big-reader writer");
+	ps->br_writer = false;
+	alloc_slots();
+}
+
+/**************************************************************************
+
+Function:	br_read_lock()
+
+Use:		Enters a read under the big-reader lock. The reader
+		counts itself in its own slot, then checks for a writer.
+		If one is there, it backs out and waits for it to leave.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void br_read_lock()
+{
+	// Note when the wait started, if waits are being timed.
+	uint64_t start = wait_hist ? now_ns() : 0;
+
+	thread_slot *slot = get_slot();
+
+	for (;;)
+	{
+		// Count the reader, then look for a writer. The writer does
+		// the same in the other order, so one of them sees the other.
+		slot->value.fetch_add(1);
+		if (!ps->br_writer.load())
+			break;
+
+		// Back out and wait for the writer to finish.
+		slot->value.fetch_sub(1);
+		while (ps->br_writer.load())
+			sched_yield();
+	}
+
+	// Record how long the wait took.
+	if (wait_hist)
+		hist_record(wait_hist, now_ns() - start);
+}
+
+/**************************************************************************
+
+Function:	br_read_unlock()
+
+Use:		Leaves a read under the big-reader lock.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void br_read_unlock()
+{
+	ps->slots[my_slot].value.fetch_sub(1, std::memory_order_release);
+}
+
+/**************************************************************************
+
+Function:	br_write_lock()
+
+Use:		Enters a write under the big-reader lock. The writer
+		shuts out new readers, then waits for every slot to
+		drain.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void br_write_lock()
+{
+	// The wait is the writers and the readers both, as one.
+	uint64_t start = wait_start();
+
+	// Wait for the other writers.
+	wait_sem(&ps->br_sem, "big-reader writer");
+
+	// Stop new readers, then wait for the ones already in.
+	ps->br_writer.store(true);
+	for (int i = 0; i < nslots; i++)
+		while (ps->slots[i].value.load() != 0)
+			sched_yield();
+
+	// Record how long the wait took.
+	wait_done(start);
+}
+
+/**************************************************************************
+
+Function:	br_write_unlock()
+
+Use:		Leaves a write under the big-reader lock.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void br_write_unlock()
+{
+	// Let the readers back in, then the next writer.
+	ps->br_writer.store(false, std::memory_order_release);
+	post_sem(&ps->br_sem, "big-reader writer");
+}
+
+/**************************************************************************
+
+Function:	br_destroy()
+
+Use:		Cleans up the big-reader lock.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void br_destroy()
+{
+	destroy_sem(&ps->br_sem, "big-reader writer");
+	shared_free(ps->slots);
+}
+
+/**************************************************************************
+
+Function:	rcu_init()
+
+Use:		Initializes the RCU policy.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void rcu_init()
+{
+	init_sem(&ps->rcu_sem, 1, "rcu writer");
+	ps->rcu_epoch = 1;
+	ps->limbo = NULL;
+	alloc_slots();
+}
+
+/**************************************************************************
+
+Function:	rcu_read_lock()
+
+Use:		Starts a read under RCU by noting the current epoch in
+		the thread's slot. It never waits.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void rcu_read_lock()
+{
+	get_slot()->value.store(ps->rcu_epoch.load());
+}
+
+/**************************************************************************
+
+Function:	rcu_read_unlock()
+
+Use:		Ends a read under RCU.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void rcu_read_unlock()
+{
+	ps->slots[my_slot].value.store(0, std::memory_order_release);
+}
+
+/**************************************************************************
+
+Function:	rcu_write_lock()
+
+Use:		Enters a write under RCU. Writers only exclude each
+		other.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void rcu_write_lock()
+{
+	uint64_t start = wait_start();
+
+	wait_sem(&ps->rcu_sem, "rcu writer");
+	wait_done(start);
+}
+
+/**************************************************************************
+
+Function:	rcu_write_unlock()
+
+Use:		Leaves a write under RCU.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void rcu_write_unlock()
+{
+	post_sem(&ps->rcu_sem, "rcu writer");
+}
+
+/**************************************************************************
+
+Function:	rcu_retire()
+
+Use:		Retires a copy the writer has just replaced, and frees
+		every retired copy that no reader can still be using.
+		Called with the write lock held.
+
+Arguments:	1. *old: The replaced copy.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void rcu_retire(void *old)
+{
+	// Put the copy in limbo, tagged with the epoch that is ending,
+	// and start a new epoch. Readers that start from now on can only
+	// see the new copy.
+	retired *r = (retired *) malloc(sizeof(retired));
+	if (r == NULL)
+	{
+		fprintf(stderr,"malloc(): retired copy - %s.\n",strerror(errno));
+		exit(-1);
+	}
+	r->ptr = old;
+	r->epoch = ps->rcu_epoch.fetch_add(1);
+	r->next = ps->limbo;
+	ps->limbo = r;
+
+	// Find the oldest epoch a reader is still in.
+	unsigned long oldest = ULONG_MAX;
+	for (int i = 0; i < nslots; i++)
+	{
+		unsigned long e = ps->slots[i].value.load();
+		if (e != 0 && e < oldest)
+			oldest = e;
+	}
+
+	// Free every copy that stopped being visible before then.
+	for (retired **p = &ps->limbo; *p != NULL; )
+	{
+		if ((*p)->epoch < oldest)
+		{
+			retired *done = *p;
+			*p = done->next;
+			free(done->ptr);
+			free(done);
+		}
+		else
+			p = &(*p)->next;
+	}
+}
+
+/**************************************************************************
+
+Function:	rcu_destroy()
+
+Use:		Cleans up the RCU policy, freeing whatever is left in
+		limbo.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void rcu_destroy()
+{
+	while (ps->limbo != NULL)
+	{
+		retired *done = ps->limbo;
+		ps->limbo = done->next;
+		free(done->ptr);
+		free(done);
+	}
+
+	destroy_sem(&ps->rcu_sem, "rcu writer");
+	shared_free(ps->slots);
+}
+
+/**************************************************************************
+
+Function:	futex_wait()
+
+Use:		Sleeps in the kernel while the futex word still holds
+		the value the caller saw. It may return early, so the
+		caller checks the word again.
+
+Arguments:	1. *word: The futex word.
+		2. value: The value the caller saw.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void futex_wait(std::atomic<unsigned> *word, unsigned value)
+{
+	int op = process_mode ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE;
+
+	ps->fx_syscalls++;
+	if (syscall(SYS_futex, (unsigned *) word, op, value, NULL, NULL, 0) != 0 &&
+	    errno != EAGAIN && errno != EINTR)
+	{
+		fprintf(stderr,"futex(): wait error - %s.\n",strerror(errno));
+		exit(-1);
+	}
+}
+
+/**************************************************************************
+
+Function:	futex_wake_all()
+
+Use:		Wakes every thread sleeping on the futex word.
+
+Arguments:	1. *word: The futex word.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void futex_wake_all(std::atomic<unsigned> *word)
+{
+	int op = process_mode ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE;
+
+	ps->fx_syscalls++;
+	if (syscall(SYS_futex, (unsigned *) word, op, INT_MAX, NULL, NULL, 0) < 0)
+	{
+		fprintf(stderr,"futex(): wake error - %s.\n",strerror(errno));
+		exit(-1);
+	}
+}
+
+/**************************************************************************
+
+Function:	fx_init()
+
+Use:		Initializes the futex lock.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void fx_init()
+{
+	ps->fx_word = 0;
+	ps->fx_syscalls = 0;
+}
+
+/**************************************************************************
+
+Function:	fx_read_lock()
+
+Use:		Enters a read under the futex lock. If no writer holds
+		it, the reader counts itself in with one compare-and-swap.
+		Otherwise, it marks the word as having sleepers and
+		sleeps until the writer leaves.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void fx_read_lock()
+{
+	uint64_t start = wait_hist ? now_ns() : 0;
+	unsigned s = ps->fx_word.load(std::memory_order_relaxed);
+
+	for (;;)
+	{
+		// Count the reader in if there is no writer.
+		if (!(s & FX_WRITER))
+		{
+			if (ps->fx_word.compare_exchange_weak(s, s + 1, std::memory_order_acquire))
+				break;
+			continue;
+		}
+
+		// Under spin-then-park, spin for the writer to leave first.
+		if (spin_max > 0 && spin_word(&ps->fx_word, FX_WRITER))
+		{
+			s = ps->fx_word.load(std::memory_order_relaxed);
+			continue;
+		}
+
+		// Say someone is sleeping, then sleep.
+		if (!(s & FX_WAITING) && !ps->fx_word.compare_exchange_weak(s, s | FX_WAITING))
+			continue;
+		futex_wait(&ps->fx_word, s | FX_WAITING);
+		s = ps->fx_word.load(std::memory_order_relaxed);
+	}
+
+	// Record how long the reader waited.
+	if (wait_hist)
+		hist_record(wait_hist, now_ns() - start);
+}
+
+/**************************************************************************
+
+Function:	fx_read_unlock()
+
+Use:		Leaves a read under the futex lock. The last reader out
+		wakes the sleepers, if there are any.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void fx_read_unlock()
+{
+	unsigned s = ps->fx_word.fetch_sub(1, std::memory_order_release) - 1;
+
+	// If this was the last reader and someone is sleeping, clear the
+	// mark and wake them. If the word changed first, whoever changed
+	// it wakes them instead.
+	if (s == FX_WAITING && ps->fx_word.compare_exchange_strong(s, 0))
+		futex_wake_all(&ps->fx_word);
+}
+
+/**************************************************************************
+
+Function:	fx_write_lock()
+
+Use:		Enters a write under the futex lock. The writer takes the
+		word with one compare-and-swap once there are no readers
+		or writer, and sleeps until then.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void fx_write_lock()
+{
+	uint64_t start = wait_hist ? now_ns() : 0;
+	unsigned s = ps->fx_word.load(std::memory_order_relaxed);
+
+	for (;;)
+	{
+		// Take the lock if it is free, keeping the sleeper mark.
+		if ((s & ~FX_WAITING) == 0)
+		{
+			if (ps->fx_word.compare_exchange_weak(s, s | FX_WRITER, std::memory_order_acquire))
+				break;
+			continue;
+		}
+
+		// Under spin-then-park, spin for the lock to be free first.
+		if (spin_max > 0 && spin_word(&ps->fx_word, ~FX_WAITING))
+		{
+			s = ps->fx_word.load(std::memory_order_relaxed);
+			continue;
+		}
+
+		// Say someone is sleeping, then sleep.
+		if (!(s & FX_WAITING) && !ps->fx_word.compare_exchange_weak(s, s | FX_WAITING))
+			continue;
+		futex_wait(&ps->fx_word, s | FX_WAITING);
+		s = ps->fx_word.load(std::memory_order_relaxed);
+	}
+
+	// Record how long the writer waited.
+	if (wait_hist)
+		hist_record(wait_hist, now_ns() - start);
+}
+
+/**************************************************************************
+
+Function:	fx_write_unlock()
+
+Use:		Leaves a write under the futex lock, and wakes the
+		sleepers if there are any.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void fx_write_unlock()
+{
+	if (ps->fx_word.exchange(0, std::memory_order_release) & FX_WAITING)
+		futex_wake_all(&ps->fx_word);
+}
+
+/**************************************************************************
+
+Function:	fx_syscalls()
+
+Use:		Counts the futex system calls the lock has made, in
+		every shard.
+
+Arguments:	None.
+
+Returns:	The count.
+
+**************************************************************************/
+
+long fx_syscalls()
+{
+	long total = 0;
+
+	for (int i = 0; i < nstates; i++)
+		total += states[i].fx_syscalls;
+	return total;
+}
+
+/**************************************************************************
+
+Function:	fx_destroy()
+
+Use:		Cleans up the futex lock.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void fx_destroy()
+{
+}
+
+/**************************************************************************
+
+Function:	co_node()
+
+Use:		Finds the calling thread's node for the cohort lock. It
+		is looked up once, so a thread that isn't pinned with
+		-R or -W stays with the node it started on.
+
+Arguments:	None.
+
+Returns:	The thread's part of the cohort lock.
+
+**************************************************************************/
+
+cohort_node *co_node()
+{
+	if (my_node < 0)
+	{
+		unsigned cpu, node;
+		if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+			node = 0;
+		my_node = node % COHORT_NODES;
+	}
+
+	return &ps->co_nodes[my_node];
+}
+
+/**************************************************************************
+
+Function:	co_init()
+
+Use:		Initializes the cohort lock.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void co_init()
+{
+	for (int i = 0; i < COHORT_NODES; i++)
+	{
+		ps->co_nodes[i].readers = 0;
+		ps->co_nodes[i].next = 0;
+		ps->co_nodes[i].serving = 0;
+		ps->co_nodes[i].global = false;
+		ps->co_nodes[i].batch = 0;
+	}
+	ps->co_next = 0;
+	ps->co_serving = 0;
+	ps->co_writer = false;
+	ps->co_waiting = 0;
+	ps->co_reader_turn = false;
+}
+
+/**************************************************************************
+
+Function:	co_read_lock()
+
+Use:		Enters a read under the cohort lock. The reader counts
+		itself on its own node, then backs out and waits while
+		any node's writers hold the lock. A reader that waits
+		says so, so the writers let it in before the next one.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void co_read_lock()
+{
+	// Note when the wait started, if waits are being timed.
+	uint64_t start = wait_hist ? now_ns() : 0;
+	cohort_node *node = co_node();
+	bool waited = false;
+
+	for (;;)
+	{
+		// Count the reader in, and stay if no writer holds the lock.
+		node->readers.fetch_add(1);
+		if (!ps->co_writer.load())
+			break;
+
+		// Back out, say the reader is waiting, and wait for the
+		// writers to let go.
+		node->readers.fetch_sub(1);
+		if (!waited)
+		{
+			ps->co_waiting.fetch_add(1);
+			waited = true;
+		}
+		while (ps->co_writer.load())
+			sched_yield();
+	}
+
+	// The last of the waiting readers to get in ends their turn.
+	if (waited && ps->co_waiting.fetch_sub(1) == 1)
+		ps->co_reader_turn.store(false);
+
+	// Record how long the wait took.
+	if (wait_hist)
+		hist_record(wait_hist, now_ns() - start);
+}
+
+/**************************************************************************
+
+Function:	co_read_unlock()
+
+Use:		Leaves a read under the cohort lock.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void co_read_unlock()
+{
+	co_node()->readers.fetch_sub(1, std::memory_order_release);
+}
+
+/**************************************************************************
+
+Function:	co_write_lock()
+
+Use:		Enters a write under the cohort lock. The writer waits
+		its turn on its node. Unless a writer on the node passed
+		it the global lock, it then waits its turn for that too
+		and shuts the readers out. Last, it waits for the readers
+		already in on every node.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void co_write_lock()
+{
+	// Note when the wait started, if waits are being timed.
+	uint64_t start = wait_hist ? now_ns() : 0;
+	cohort_node *node = co_node();
+
+	// Wait for the writers ahead on this node.
+	unsigned ticket = node->next.fetch_add(1);
+	while (node->serving.load(std::memory_order_acquire) != ticket)
+		sched_yield();
+
+	// Take the global lock, unless the node already has it.
+	if (!node->global)
+	{
+		unsigned gticket = ps->co_next.fetch_add(1);
+		while (ps->co_serving.load(std::memory_order_acquire) != gticket)
+			sched_yield();
+		node->global = true;
+		node->batch = 0;
+
+		// Let the readers that were waiting in first, then shut
+		// out new readers.
+		while (ps->co_reader_turn.load())
+			sched_yield();
+		ps->co_writer.store(true);
+	}
+
+	// Wait for the readers already in.
+	for (int i = 0; i < COHORT_NODES; i++)
+		while (ps->co_nodes[i].readers.load() != 0)
+			sched_yield();
+
+	// Record how long the wait took.
+	if (wait_hist)
+		hist_record(wait_hist, now_ns() - start);
+}
+
+/**************************************************************************
+
+Function:	co_write_unlock()
+
+Use:		Leaves a write under the cohort lock. If another writer
+		on the node is waiting and the node hasn't passed the
+		lock too many times in a row, it gets the lock without
+		the global lock changing hands. Otherwise the readers
+		are let in and the global lock is released. If readers
+		were waiting, it is their turn: the next writer waits
+		until they are all in.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void co_write_unlock()
+{
+	cohort_node *node = co_node();
+	unsigned serving = node->serving.load(std::memory_order_relaxed);
+	bool waiting = node->next.load() != serving + 1;
+	bool readers_waiting = ps->co_waiting.load() > 0;
+
+	// Pass the lock to the next writer on the node.
+	if (waiting && ++node->batch < COHORT_BATCH)
+	{
+		node->serving.store(serving + 1, std::memory_order_release);
+		return;
+	}
+
+	// Or let the readers in, giving those that waited the next
+	// turn, and hand the global lock on.
+	node->global = false;
+	if (readers_waiting)
+		ps->co_reader_turn.store(true);
+	ps->co_writer.store(false);
+	ps->co_serving.fetch_add(1, std::memory_order_release);
+	node->serving.store(serving + 1, std::memory_order_release);
+}
+
+/**************************************************************************
+
+Function:	co_destroy()
+
+Use:		Cleans up the cohort lock.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void co_destroy()
+{
+}
+
+/**************************************************************************
+
+Function:	dl_init()
+
+Use:		Initializes the deadline policy's mutex and condition
+		variables. They are shared between processes when the
+		readers and writers are processes, and the condition
+		variables time out on CLOCK_MONOTONIC.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void dl_init()
+{
+	int pshared = process_mode ? PTHREAD_PROCESS_SHARED : PTHREAD_PROCESS_PRIVATE;
+	pthread_mutexattr_t mattr;
+	pthread_condattr_t cattr;
+
+	pthread_mutexattr_init(&mattr);
+	pthread_mutexattr_setpshared(&mattr, pshared);
+	pthread_condattr_init(&cattr);
+	pthread_condattr_setpshared(&cattr, pshared);
+	pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+
+	int err = pthread_mutex_init(&ps->dl_mutex, &mattr);
+	if (err == 0)
+		err = pthread_cond_init(&ps->dl_readers, &cattr);
+	if (err == 0)
+		err = pthread_cond_init(&ps->dl_writers, &cattr);
+	pthread_mutexattr_destroy(&mattr);
+	pthread_condattr_destroy(&cattr);
+	if (err != 0)
+	{
+		fprintf(stderr,"pthread_mutex_init(): deadline lock - %s.\n",strerror(err));
+		exit(-1);
+	}
+
+	ps->dl_reading = 0;
+	ps->dl_writing = false;
+	ps->dl_boosted = 0;
+	ps->dl_boosts = 0;
+}
+
+/**************************************************************************
+
+Function:	dl_wait()
+
+Use:		Waits on one of the deadline policy's condition
+		variables, holding its mutex.
+
+Arguments:	1. *cond: The condition variable.
+		2. until: When to stop waiting, in ns, or NO_DEADLINE.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void dl_wait(pthread_cond_t *cond, uint64_t until)
+{
+	int err;
+
+	if (until == NO_DEADLINE)
+		err = pthread_cond_wait(cond, &ps->dl_mutex);
+	else
+	{
+		struct timespec ts;
+		ts.tv_sec = until / 1000000000;
+		ts.tv_nsec = until % 1000000000;
+		err = pthread_cond_timedwait(cond, &ps->dl_mutex, &ts);
+	}
+
+	// Timing out is how a deadline passes, so it isn't an error.
+	if (err != 0 && err != ETIMEDOUT)
+	{
+		fprintf(stderr,"pthread_cond_wait(): deadline lock - %s.\n",strerror(err));
+		exit(-1);
+	}
+}
+
+/**************************************************************************
+
+Function:	dl_read_lock_until()
+
+Use:		Enters a read under the deadline policy. Readers go in
+		unless a writer is writing or boosted.
+
+Arguments:	1. deadline: When to give up, in ns, or NO_DEADLINE.
+
+Returns:	true if the reader got in, false if the deadline passed.
+
+**************************************************************************/
+
+bool dl_read_lock_until(uint64_t deadline)
+{
+	uint64_t start = wait_hist ? now_ns() : 0;
+	bool got = true;
+
+	pthread_mutex_lock(&ps->dl_mutex);
+	while (ps->dl_writing || ps->dl_boosted > 0)
+	{
+		if (deadline != NO_DEADLINE && now_ns() >= deadline)
+		{
+			got = false;
+			break;
+		}
+		dl_wait(&ps->dl_readers, deadline);
+	}
+	if (got)
+		ps->dl_reading++;
+	pthread_mutex_unlock(&ps->dl_mutex);
+
+	// Record how long the reader waited.
+	if (got && wait_hist)
+		hist_record(wait_hist, now_ns() - start);
+
+	return got;
+}
+
+/**************************************************************************
+
+Function:	dl_read_lock()
+
+Use:		Enters a read under the deadline policy, however long
+		it takes.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void dl_read_lock()
+{
+	dl_read_lock_until(NO_DEADLINE);
+}
+
+/**************************************************************************
+
+Function:	dl_read_unlock()
+
+Use:		Leaves a read under the deadline policy. The last reader
+		wakes the writers.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void dl_read_unlock()
+{
+	pthread_mutex_lock(&ps->dl_mutex);
+	if (--ps->dl_reading == 0)
+		pthread_cond_broadcast(&ps->dl_writers);
+	pthread_mutex_unlock(&ps->dl_mutex);
+}
+
+/**************************************************************************
+
+Function:	dl_write_lock_until()
+
+Use:		Enters a write under the deadline policy. The writer
+		waits behind the readers like under reader priority
+		until half its time to the deadline is gone. Then it
+		is boosted, and new readers wait until it has been
+		through or given up.
+
+Arguments:	1. deadline: When to give up, in ns, or NO_DEADLINE to
+		             wait without ever being boosted.
+
+Returns:	true if the writer got in, false if the deadline passed.
+
+**************************************************************************/
+
+bool dl_write_lock_until(uint64_t deadline)
+{
+	uint64_t now = now_ns();
+	uint64_t start = now;
+	// Boost halfway to the deadline.
+	uint64_t boost_at = deadline == NO_DEADLINE ? NO_DEADLINE :
+			    deadline > now ? now + (deadline - now) / 2 : now;
+	bool boosted = false;
+	bool got = true;
+
+	pthread_mutex_lock(&ps->dl_mutex);
+	while (ps->dl_writing || ps->dl_reading > 0)
+	{
+		now = now_ns();
+		if (deadline != NO_DEADLINE && now >= deadline)
+		{
+			got = false;
+			break;
+		}
+
+		// Past halfway, shut out new readers.
+		if (!boosted && now >= boost_at)
+		{
+			boosted = true;
+			ps->dl_boosted++;
+			ps->dl_boosts++;
+		}
+
+		// Wake up at the boost, or at the deadline.
+		dl_wait(&ps->dl_writers, boosted ? deadline : boost_at);
+	}
+	if (got)
+		ps->dl_writing = true;
+
+	// Stop holding readers back. The last boosted writer lets them
+	// in if nobody is writing.
+	if (boosted && --ps->dl_boosted == 0 && !ps->dl_writing)
+		pthread_cond_broadcast(&ps->dl_readers);
+	pthread_mutex_unlock(&ps->dl_mutex);
+
+	// Record how long the writer waited.
+	if (got && wait_hist)
+		hist_record(wait_hist, now_ns() - start);
+
+	return got;
+}
+
+/**************************************************************************
+
+Function:	dl_write_lock()
+
+Use:		Enters a write under the deadline policy, however long
+		it takes. Without a deadline the writer is never
+		boosted.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void dl_write_lock()
+{
+	dl_write_lock_until(NO_DEADLINE);
+}
+
+/**************************************************************************
+
+Function:	dl_write_unlock()
+
+Use:		Leaves a write under the deadline policy, and wakes
+		every reader and writer to try again.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void dl_write_unlock()
+{
+	pthread_mutex_lock(&ps->dl_mutex);
+	ps->dl_writing = false;
+	pthread_cond_broadcast(&ps->dl_writers);
+	pthread_cond_broadcast(&ps->dl_readers);
+	pthread_mutex_unlock(&ps->dl_mutex);
+}
+
+/**************************************************************************
+
+Function:	dl_destroy()
+
+Use:		Cleans up the deadline policy.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void dl_destroy()
+{
+	pthread_cond_destroy(&ps->dl_readers);
+	pthread_cond_destroy(&ps->dl_writers);
+	pthread_mutex_destroy(&ps->dl_mutex);
+}
+
+/**************************************************************************
+
+Function:	prw_init()
+
+Use:		Initializes the pthread_rwlock_t. It is shared between
+		processes when the readers and writers are processes.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void prw_init()
+{
+	pthread_rwlockattr_t attr;
+
+	pthread_rwlockattr_init(&attr);
+	pthread_rwlockattr_setpshared(&attr, process_mode ? PTHREAD_PROCESS_SHARED : PTHREAD_PROCESS_PRIVATE);
+	int err = pthread_rwlock_init(&ps->prw_lock, &attr);
+	pthread_rwlockattr_destroy(&attr);
+	if (err != 0)
+	{
+		fprintf(stderr,"pthread_rwlock_init(): %s.\n",strerror(err));
+		exit(-1);
+	}
+}
+
+/**************************************************************************
+
+Function:	prw_read_lock()
+
+Use:		Enters a read under the pthread_rwlock_t.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void prw_read_lock()
+{
+	uint64_t start = wait_hist ? now_ns() : 0;
+
+	int err = pthread_rwlock_rdlock(&ps->prw_lock);
+	if (err != 0)
+	{
+		fprintf(stderr,"pthread_rwlock_rdlock(): %s.\n",strerror(err));
+		exit(-1);
+	}
+
+	if (wait_hist)
+		hist_record(wait_hist, now_ns() - start);
+}
+
+/**************************************************************************
+
+Function:	prw_write_lock()
+
+Use:		Enters a write under the pthread_rwlock_t.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void prw_write_lock()
+{
+	uint64_t start = wait_hist ? now_ns() : 0;
+
+	int err = pthread_rwlock_wrlock(&ps->prw_lock);
+	if (err != 0)
+	{
+		fprintf(stderr,"pthread_rwlock_wrlock(): %s.\n",strerror(err));
+		exit(-1);
+	}
+
+	if (wait_hist)
+		hist_record(wait_hist, now_ns() - start);
+}
+
+/**************************************************************************
+
+Function:	prw_lock_until()
+
+Use:		Takes the pthread_rwlock_t by a deadline: tries it, then
+		waits with the timed call if there is time left.
+
+Arguments:	1. write: true to write, false to read.
+		2. deadline: When to give up, in ns.
+
+Returns:	true if it was taken, false if the deadline passed.
+
+**************************************************************************/
+
+bool prw_lock_until(bool write, uint64_t deadline)
+{
+	uint64_t start = wait_hist ? now_ns() : 0;
+
+	// Try it, then wait until the deadline, on CLOCK_REALTIME.
+	int err = write ? pthread_rwlock_trywrlock(&ps->prw_lock) : pthread_rwlock_tryrdlock(&ps->prw_lock);
+	if (err == EBUSY && deadline > now_ns())
+	{
+		struct timespec ts;
+		abs_time(deadline, CLOCK_REALTIME, &ts);
+		err = write ? pthread_rwlock_timedwrlock(&ps->prw_lock, &ts) :
+			      pthread_rwlock_timedrdlock(&ps->prw_lock, &ts);
+	}
+
+	if (err == EBUSY || err == ETIMEDOUT)
+		return false;
+	if (err != 0)
+	{
+		fprintf(stderr,"pthread_rwlock_timed%slock(): %s.\n",write ? "wr" : "rd",strerror(err));
+		exit(-1);
+	}
+
+	if (wait_hist)
+		hist_record(wait_hist, now_ns() - start);
+
+	return true;
+}
+
+/**************************************************************************
+
+Function:	prw_read_lock_until()
+
+Use:		Enters a read under the pthread_rwlock_t by a deadline.
+
+Arguments:	1. deadline: When to give up, in ns.
+
+Returns:	true if the reader got in, false if the deadline passed.
+
+**************************************************************************/
+
+bool prw_read_lock_until(uint64_t deadline)
+{
+	return prw_lock_until(false, deadline);
+}
+
+/**************************************************************************
+
+Function:	prw_write_lock_until()
+
+Use:		Enters a write under the pthread_rwlock_t by a deadline.
+
+Arguments:	1. deadline: When to give up, in ns.
+
+Returns:	true if the writer got in, false if the deadline passed.
+
+**************************************************************************/
+
+bool prw_write_lock_until(uint64_t deadline)
+{
+	return prw_lock_until(true, deadline);
+}
+
+/**************************************************************************
+
+Function:	prw_unlock()
+
+Use:		Leaves a read or write under the pthread_rwlock_t.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void prw_unlock()
+{
+	int err = pthread_rwlock_unlock(&ps->prw_lock);
+	if (err != 0)
+	{
+		fprintf(stderr,"pthread_rwlock_unlock(): %s.\n",strerror(err));
+		exit(-1);
+	}
+}
+
+/**************************************************************************
+
+Function:	prw_destroy()
+
+Use:		Cleans up the pthread_rwlock_t.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void prw_destroy()
+{
+	pthread_rwlock_destroy(&ps->prw_lock);
+}
+
+/**************************************************************************
+
+Function:	sm_init()
+
+Use:		Initializes the std::shared_mutex.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void sm_init()
+{
+	new (&ps->sm_lock) std::shared_mutex();
+}
+
+/**************************************************************************
+
+Function:	sm_read_lock()
+
+Use:		Enters a read under the std::shared_mutex.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void sm_read_lock()
+{
+	uint64_t start = wait_hist ? now_ns() : 0;
+
+	ps->sm_lock.lock_shared();
+
+	if (wait_hist)
+		hist_record(wait_hist, now_ns() - start);
+}
+
+/**************************************************************************
+
+Function:	sm_read_unlock()
+
+Use:		Leaves a read under the std::shared_mutex.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void sm_read_unlock()
+{
+	ps->sm_lock.unlock_shared();
+}
+
+/**************************************************************************
+
+Function:	sm_write_lock()
+
+Use:		Enters a write under the std::shared_mutex.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void sm_write_lock()
+{
+	uint64_t start = wait_hist ? now_ns() : 0;
+
+	ps->sm_lock.lock();
+
+	if (wait_hist)
+		hist_record(wait_hist, now_ns() - start);
+}
+
+/**************************************************************************
+
+Function:	sm_write_unlock()
+
+Use:		Leaves a write under the std::shared_mutex.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void sm_write_unlock()
+{
+	ps->sm_lock.unlock();
+}
+
+/**************************************************************************
+
+Function:	sm_destroy()
+
+Use:		Cleans up the std::shared_mutex.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void sm_destroy()
+{
+	ps->sm_lock.~shared_mutex();
+}
+
+// Every policy, in the order usage() lists them.
+const lock_policy policies[] =
+{
+	{ "reader-pref", "readers have priority", false, false,
+	  rp_init, rp_read_lock, rp_read_unlock, rp_write_lock, rp_write_unlock,
+	  release_none, rp_destroy, NULL, NULL, NULL, NULL,
+	  rp_read_lock_until, rp_write_lock_until },
+	{ "writer-pref", "writers have priority", false, false,
+	  wp_init, wp_read_lock, wp_read_unlock, wp_write_lock, wp_write_unlock,
+	  release_none, wp_destroy, NULL, NULL, NULL, NULL,
+	  wp_read_lock_until, wp_write_lock_until },
+	{ "alternate", "readers and writers alternate", true, false,
+	  alt_init, alt_read_lock, alt_read_unlock, alt_write_lock, alt_write_unlock,
+	  alt_release, alt_destroy },
+	{ "phase-fair", "phase-fair ticket lock", false, false,
+	  pf_init, pf_read_lock, pf_read_unlock, pf_write_lock, pf_write_unlock,
+	  release_none, pf_destroy },
+	{ "seqlock", "optimistic reads checked by a sequence number", false, false,
+	  sl_init, NULL, NULL, sl_write_lock, sl_write_unlock,
+	  release_none, sl_destroy, sl_read_begin, sl_read_retry },
+	{ "big-reader", "per-reader slots, writers drain every slot", false, false,
+	  br_init, br_read_lock, br_read_unlock, br_write_lock, br_write_unlock,
+	  release_none, br_destroy },
+	{ "rcu", "readers never wait, writers publish new copies", false, true,
+	  rcu_init, rcu_read_lock, rcu_read_unlock, rcu_write_lock, rcu_write_unlock,
+	  release_none, rcu_destroy, NULL, NULL, rcu_retire },
+	{ "futex", "one atomic word, futex() only to sleep", false, false,
+	  fx_init, fx_read_lock, fx_read_unlock, fx_write_lock, fx_write_unlock,
+	  release_none, fx_destroy, NULL, NULL, NULL, fx_syscalls },
+	{ "cohort", "NUMA cohort lock, readers counted per node", false, false,
+	  co_init, co_read_lock, co_read_unlock, co_write_lock, co_write_unlock,
+	  release_none, co_destroy },
+	{ "deadline", "writers near their deadline shut out new readers", false, false,
+	  dl_init, dl_read_lock, dl_read_unlock, dl_write_lock, dl_write_unlock,
+	  release_none, dl_destroy, NULL, NULL, NULL, NULL,
+	  dl_read_lock_until, dl_write_lock_until },
+	{ "pthread-rwlock", "the C library's pthread_rwlock_t", false, false,
+	  prw_init, prw_read_lock, prw_unlock, prw_write_lock, prw_unlock,
+	  release_none, prw_destroy, NULL, NULL, NULL, NULL,
+	  prw_read_lock_until, prw_write_lock_until },
+	{ "shared-mutex", "the C++ library's std::shared_mutex", false, true,
+	  sm_init, sm_read_lock, sm_read_unlock, sm_write_lock, sm_write_unlock,
+	  release_none, sm_destroy },
+};
+
+/**************************************************************************
+
+Function:	policy_init()
+
+Use:		Allocates the policy state of every shard where every
+		reader and writer can see it, then initializes the policy
+		the run uses in each.
+
+Arguments:	1. shards: The number of shards.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void policy_init(int shards)
+{
+	nstates = shards;
+	states = (policy_state *) shared_alloc(nstates * sizeof(policy_state));
+	for (int i = 0; i < nstates; i++)
+	{
+		ps = new (&states[i]) policy_state();
+		ps->spin_budget = spin_max;
+		policy->init();
+	}
+}
+
+/**************************************************************************
+
+Function:	policy_select()
+
+Use:		Picks the shard whose lock the calling thread's next
+		policy calls work on.
+
+Arguments:	1. shard: The shard.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void policy_select(int shard)
+{
+	ps = &states[shard];
+}
+
+/**************************************************************************
+
+Function:	policy_release()
+
+Use:		Wakes the threads that may be blocked for good at the
+		end of a run, in every shard.
+
+Arguments:	1. readers: The number of reader threads.
+		2. writers: The number of writer threads.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void policy_release(int readers, int writers)
+{
+	for (int i = 0; i < nstates; i++)
+	{
+		ps = &states[i];
+		policy->release(readers, writers);
+	}
+}
+
+/**************************************************************************
+
+Function:	policy_spins()
+
+Use:		Adds up how contended acquires ended under
+		spin-then-park, over every shard.
+
+Arguments:	1. *won: Where to put the number that got the lock by
+		   spinning.
+		2. *parked: Where to put the number that had to sleep.
+
+Returns:	The shards' average spin budget.
+
+**************************************************************************/
+
+int policy_spins(long *won, long *parked)
+{
+	long budget = 0;
+
+	*won = 0;
+	*parked = 0;
+	for (int i = 0; i < nstates; i++)
+	{
+		*won += states[i].spin_wins;
+		*parked += states[i].spin_parks;
+		budget += states[i].spin_budget;
+	}
+
+	return nstates > 0 ? budget / nstates : 0;
+}
+
+/**************************************************************************
+
+Function:	policy_boosts()
+
+Use:		Counts the times writers were boosted under the
+		deadline policy, over every shard.
+
+Arguments:	None.
+
+Returns:	The number of boosts.
+
+**************************************************************************/
+
+long policy_boosts()
+{
+	long boosts = 0;
+
+	for (int i = 0; i < nstates; i++)
+		boosts += states[i].dl_boosts;
+
+	return boosts;
+}
+
+/**************************************************************************
+
+Function:	policy_destroy()
+
+Use:		Cleans up the policy the run used in every shard, and
+		frees the state.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void policy_destroy()
+{
+	for (int i = 0; i < nstates; i++)
+	{
+		ps = &states[i];
+		policy->destroy();
+	}
+	shared_free(states);
+	ps = NULL;
+}
+
+/**************************************************************************
+
+Function:	find_policy()
+
+Use:		Looks up a policy by name.
+
+Arguments:	1. *name: The policy's name.
+
+Returns:	The policy, or NULL if there is none by that name.
+
+**************************************************************************/
+
+const lock_policy *find_policy(const char *name)
+{
+	for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++)
+		if (strcmp(policies[i].name, name) == 0)
+			return &policies[i];
+
+	return NULL;
+}
+
+/**************************************************************************
+
+Function:	list_policies()
+
+Use:		Prints the name and description of every policy.
+
+Arguments:	1. *out: Where to print them.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void list_policies(FILE *out)
+{
+	for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++)
+		fprintf(out,"                %-12s - %s.\n",policies[i].name,policies[i].desc);
+}
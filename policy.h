@@ -0,0 +1,73 @@
+/**************************************************************************
+
+Reader/Writer Problem - Lock Policies
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Declares the lock policies the readers and writers can
+		run under. Each policy is a table of functions, so the
+		policy can be picked at runtime with -p.
+
+**************************************************************************/
+#ifndef POLICY_H
+#define POLICY_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// The deadline of a request that waits as long as it takes.
+const uint64_t NO_DEADLINE = UINT64_MAX;
+
+struct lock_policy
+{
+	const char *name;		// Name given to -p.
+	const char *desc;		// One line description for usage().
+	bool alternates;		// Readers and writers take turns, so neither
+					// side can run once the other is done.
+	bool threads_only;		// Can't be shared between processes (-P).
+	void (*init)();
+	void (*read_lock)();
+	void (*read_unlock)();
+	void (*write_lock)();
+	void (*write_unlock)();
+	// Wakes every thread that may be blocked for good at the end of a run.
+	void (*release)(int readers, int writers);
+	void (*destroy)();
+	// Optimistic reads. When set, readers don't take the lock: they
+	// copy the data between read_begin() and read_retry(), and copy
+	// it again if read_retry() says a writer got in.
+	unsigned (*read_begin)();
+	bool (*read_retry)(unsigned seq);
+	// Snapshots. When set, writers don't change the data in place:
+	// they publish a new copy and pass the old one to retire(), which
+	// frees it once no reader can still be using it.
+	void (*retire)(void *old);
+	// Counts the system calls the policy has made itself, when it
+	// can tell.
+	long (*syscalls)();
+	// Timed and try acquires. When set, they take the lock like
+	// read_lock() and write_lock(), but give up and return false at
+	// the deadline, in ns on the CLOCK_MONOTONIC clock. A deadline
+	// that has passed only tries once.
+	bool (*read_lock_until)(uint64_t deadline);
+	bool (*write_lock_until)(uint64_t deadline);
+};
+
+// The policy the run uses.
+extern const lock_policy *policy;
+
+// Most times a contended acquire spins before it sleeps, set with -S,
+// or 0 to sleep at once.
+extern int spin_max;
+
+void policy_init(int shards);
+void policy_select(int shard);
+void policy_release(int readers, int writers);
+int policy_spins(long *won, long *parked);
+long policy_boosts();
+void policy_destroy();
+const lock_policy *find_policy(const char *name);
+void list_policies(FILE *out);
+
+#endif
@@ -0,0 +1,284 @@
+/**************************************************************************
+
+Reader/Writer Problem - Worker Pool
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Runs tasks, numbered from 0, on a fixed pool of worker
+		threads. Each worker has its own deque of tasks. It runs
+		the oldest task in its deque for one step and, if the task
+		isn't done, puts it back at the other end, so the tasks
+		it holds take turns. A worker whose deque is empty steals
+		the oldest task from another worker's deque.
+
+		The deques are Chase-Lev deques: only the owner puts tasks
+		in, and anyone takes them out with a compare-and-swap on
+		the top. A deque has room for every task, so it never has
+		to grow.
+
+**************************************************************************/
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <atomic>
+#include <new>
+#include "pool.h"
+
+struct alignas(64) task_deque
+{
+	std::atomic<long> top;			// Oldest task, taken next.
+	alignas(64) std::atomic<long> bottom;	// Where the owner puts the next task.
+	std::atomic<long> *tasks;		// The tasks, indexed modulo the size.
+};
+
+task_deque *deques;
+int ndeques;
+long deque_mask;
+
+// The step function, and the tasks that aren't done yet.
+pool_step run_step;
+std::atomic<long> tasks_left;
+
+// The worker threads.
+pthread_t *workers;
+int nworkers;
+
+// The calling thread's worker index, or -1 if it isn't a worker.
+thread_local int my_worker = -1;
+
+/**************************************************************************
+
+Function:	deque_push()
+
+Use:		Puts a task at the bottom of a deque. Only the deque's
+		owner may call it.
+
+Arguments:	1. *d: The deque.
+		2. task: The task.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void deque_push(task_deque *d, long task)
+{
+	long b = d->bottom.load(std::memory_order_relaxed);
+
+	// Fill the slot, then make it visible to the takers.
+	d->tasks[b & deque_mask].store(task, std::memory_order_relaxed);
+	d->bottom.store(b + 1, std::memory_order_release);
+}
+
+/**************************************************************************
+
+Function:	deque_take()
+
+Use:		Takes the task at the top of a deque, the one that has
+		waited longest. Any thread may call it.
+
+Arguments:	1. *d: The deque.
+
+Returns:	The task, or -1 if the deque is empty.
+
+**************************************************************************/
+
+long deque_take(task_deque *d)
+{
+	for (;;)
+	{
+		long t = d->top.load(std::memory_order_acquire);
+		long b = d->bottom.load(std::memory_order_acquire);
+
+		if (t >= b)
+			return -1;
+
+		// Read the task, then claim it. If someone else claimed it
+		// first, try the new top.
+		long task = d->tasks[t & deque_mask].load(std::memory_order_relaxed);
+		if (d->top.compare_exchange_strong(t, t + 1))
+			return task;
+	}
+}
+
+/**************************************************************************
+
+Function:	worker_thread()
+
+Use:		A worker thread. It runs tasks from its own deque, or
+		steals them, until every task is done.
+
+Arguments:	1. *param: The worker's index.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void *worker_thread(void *param)
+{
+	my_worker = (int) (long) param;
+	task_deque *own = &deques[my_worker];
+
+	while (tasks_left.load(std::memory_order_relaxed) > 0)
+	{
+		// Take a task of its own, or steal one, starting with the
+		// next worker over.
+		long task = deque_take(own);
+		for (int i = 1; task < 0 && i < ndeques; i++)
+			task = deque_take(&deques[(my_worker + i) % ndeques]);
+
+		// If there is nothing to run, let the other workers in.
+		if (task < 0)
+		{
+			sched_yield();
+			continue;
+		}
+
+		// Run one step, and put the task back if it isn't done.
+		if (run_step(task))
+			deque_push(own, task);
+		else
+			tasks_left--;
+	}
+
+	pthread_exit(0);
+}
+
+/**************************************************************************
+
+Function:	pool_start()
+
+Use:		Starts a pool of workers that runs every task to the
+		end.
+
+Arguments:	1. count: The number of worker threads.
+		2. ntasks: The number of tasks.
+		3. step: Runs one step of a task.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void pool_start(int count, long ntasks, pool_step step)
+{
+	// Every deque has room for every task.
+	long size = 1;
+	while (size < ntasks)
+		size <<= 1;
+	deque_mask = size - 1;
+
+	// Allocate the deques.
+	void *mem;
+	ndeques = count;
+	if (posix_memalign(&mem, alignof(task_deque), ndeques * sizeof(task_deque)) != 0)
+	{
+		fprintf(stderr,"posix_memalign(): task deques - out of memory.\n");
+		exit(-1);
+	}
+	deques = (task_deque *) mem;
+	for (int i = 0; i < ndeques; i++)
+	{
+		new (&deques[i]) task_deque();
+		deques[i].tasks = new (std::nothrow) std::atomic<long>[size];
+		if (deques[i].tasks == NULL)
+		{
+			fprintf(stderr,"new: %ld task deque - out of memory.\n",size);
+			exit(-1);
+		}
+	}
+
+	// Deal the tasks out to the workers before they start.
+	run_step = step;
+	tasks_left = ntasks;
+	for (long i = 0; i < ntasks; i++)
+		deque_push(&deques[i % ndeques], i);
+
+	// Start the workers.
+	nworkers = count;
+	workers = (pthread_t *) malloc(nworkers * sizeof(pthread_t));
+	if (workers == NULL)
+	{
+		fprintf(stderr,"malloc(): worker ids - %s.\n",strerror(errno));
+		exit(-1);
+	}
+	for (long i = 0; i < nworkers; i++)
+	{
+		if (pthread_create(&workers[i],NULL,worker_thread,(void *)i) != 0)
+		{
+			fprintf(stderr,"pthread_create(): worker %ld error - %s.\n",i,strerror(errno));
+			exit(-1);
+		}
+	}
+}
+
+/**************************************************************************
+
+Function:	pool_wait()
+
+Use:		Waits for the workers to run out of tasks, then frees the
+		pool.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void pool_wait()
+{
+	// Wait for the workers to run out of tasks.
+	for (int i = 0; i < nworkers; i++)
+	{
+		if (pthread_join(workers[i],NULL) != 0)
+		{
+			fprintf(stderr,"pthread_join(): worker %d error - %s.\n",i,strerror(errno));
+			exit(-1);
+		}
+	}
+
+	// Free the deques.
+	for (int i = 0; i < ndeques; i++)
+		delete[] deques[i].tasks;
+	free(deques);
+	free(workers);
+}
+
+/**************************************************************************
+
+Function:	pool_worker()
+
+Use:		Finds which worker the calling thread is.
+
+Arguments:	None.
+
+Returns:	The worker's index, from 0.
+
+**************************************************************************/
+
+int pool_worker()
+{
+	return my_worker;
+}
+
+/**************************************************************************
+
+Function:	pool_cores()
+
+Use:		Counts the online cores, for one worker per core.
+
+Arguments:	None.
+
+Returns:	The number of cores, at least 1.
+
+**************************************************************************/
+
+int pool_cores()
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return n > 0 ? (int) n : 1;
+}
@@ -0,0 +1,24 @@
+/**************************************************************************
+
+Reader/Writer Problem - Worker Pool
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Declares the worker pool that runs a large number of
+		logical readers and writers on a few threads.
+
+**************************************************************************/
+#ifndef POOL_H
+#define POOL_H
+
+// Runs one step of a task. Returns true if the task has more to do, or
+// false once it is done.
+typedef bool (*pool_step)(long task);
+
+void pool_start(int count, long ntasks, pool_step step);
+void pool_wait();
+int pool_worker();
+int pool_cores();
+
+#endif
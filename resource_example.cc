@@ -0,0 +1,144 @@
+/**************************************************************************
+
+Reader/Writer Problem - Shared Resource Example
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Uses SharedResource with each lock policy in
+		shared_resource.h, so the whole header is compiled and
+		run on every build. Each policy is read, written, and
+		given a write with a deadline that can't be met while a
+		read holds the lock. Anything that goes wrong is printed
+		and ends the program with an error.
+
+**************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "shared_resource.h"
+
+// What the resource holds.
+struct config
+{
+	int port;
+	long version;
+};
+
+// How long a write may wait while a read holds the lock, in ns.
+const uint64_t WAIT_NS = 1000000;
+
+/**************************************************************************
+
+Function:	check()
+
+Use:		Ends the program if something that should be true
+		isn't.
+
+Arguments:	1. ok: Whether it is true.
+		2. *policy: The policy being checked.
+		3. *what: What should be true.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void check(bool ok, const char *policy, const char *what)
+{
+	if (!ok)
+	{
+		fprintf(stderr,"%s: %s.\n",policy,what);
+		exit(-1);
+	}
+}
+
+/**************************************************************************
+
+Function:	use_policy()
+
+Use:		Reads and writes a resource under a policy that can
+		give up, and checks that a write by a deadline times out
+		behind a read and goes through once the read is done.
+
+Arguments:	1. *name: The policy's name.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+template <typename Policy>
+void use_policy(const char *name)
+{
+	SharedResource<config, Policy> conf(config{ 8080, 0 });
+
+	// Write, then read back what was written.
+	{
+		auto w = conf.write();
+		w->version++;
+	}
+	{
+		auto r = conf.read();
+		check(r->port == 8080 && r->version == 1, name, "read didn't see the write");
+
+		// The read holds the lock, so the write runs out of time.
+		auto w = conf.try_write(resource_now_ns() + WAIT_NS);
+		check(!w, name, "write got the lock while it was read");
+	}
+
+	// With the read done, the write gets the lock in time.
+	if (auto w = conf.try_write(resource_now_ns() + WAIT_NS))
+		w->version++;
+	else
+		check(false, name, "write didn't get a free lock");
+	check(conf.read()->version == 2, name, "read didn't see the timed write");
+
+	printf("%s: ok\n",name);
+}
+
+/**************************************************************************
+
+Function:	use_alternate()
+
+Use:		Reads and writes a resource under alternate_lock, which
+		can't give up, taking turns as it requires.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void use_alternate()
+{
+	SharedResource<config, alternate_lock<> > conf(config{ 8080, 0 });
+
+	// A reader goes first, then a writer, then a reader again.
+	check(conf.read()->version == 0, "alternate_lock", "first read saw a write");
+	conf.write()->version++;
+	check(conf.read()->version == 1, "alternate_lock", "read didn't see the write");
+
+	// Hand out the turns no one will take.
+	conf.policy().release(1, 1);
+
+	printf("alternate_lock: ok\n");
+}
+
+/**************************************************************************
+
+Function:	main()
+
+Use:		Checks every policy.
+
+Arguments:	None.
+
+Returns:	The program's exit status.
+
+**************************************************************************/
+
+int main()
+{
+	use_policy<reader_pref_lock<> >("reader_pref_lock");
+	use_policy<writer_pref_lock<> >("writer_pref_lock");
+	use_alternate();
+
+	return 0;
+}
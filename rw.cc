@@ -0,0 +1,2895 @@
+/**************************************************************************
+
+Reader/Writer Problem - Simulation
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Creates reader and writer threads. Writers chop off the
+		last letter of a string, and readers print it. The lock
+		policy they run under is picked with -p (see policy.cc).
+
+		With -b, the program runs as a throughput benchmark: the
+		sleeps and printing are removed, writers refill the string
+		once it is empty, and the run lasts for a fixed number of
+		seconds or operations per thread.
+
+		With -P, the readers and writers are forked processes
+		instead of threads, and everything they share lives in
+		shared memory (see shm.cc). With -m, a few worker
+		threads run the readers and writers as tasks (see
+		pool.cc), so there can be far more of them than threads.
+		With -a, they are coroutines on an executor, and take an
+		asynchronous lock that never blocks a thread (see
+		coro.cc).
+
+**************************************************************************/
+#include <string.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sched.h>
+#include <atomic>
+#include <new>
+#include "rw.h"
+#include "policy.h"
+#include "log.h"
+#include "buffer.h"
+#include "shm.h"
+#include "pool.h"
+#include "coro.h"
+#include "place.h"
+#include "perf.h"
+#include "trace.h"
+#include "kernel.h"
+
+// The program's name, for usage().
+const char *prog_name;
+
+int num_readers;
+int num_writers;
+int num_threads;
+
+// Run the readers and writers as tasks on this many workers, set with
+// -m.
+bool pool_mode = false;
+int pool_workers = 0;
+
+// Run the readers and writers as coroutines on this many executor
+// threads, set with -a.
+bool coro_mode = false;
+int coro_workers = 0;
+
+// The CPUs readers and writers are pinned to, set with -R and -W.
+cpu_list reader_cpus;
+cpu_list writer_cpus;
+
+// Set when -p picks a policy.
+bool policy_given = false;
+
+// Benchmark settings, set by check_args().
+bool bench_mode = false;
+int bench_secs = 5;
+long bench_ops = 0;
+bool time_waits = false;
+
+// A wait for the lock longer than this counts as starving, set with -F
+// in ms, or 0.
+bool fair_mode = false;
+long starve_ns = 0;
+
+// How long a read or write may wait for the lock, in ns, set with -d
+// and -D, or -1 to wait as long as it takes. A request that runs out
+// of time is counted as missed and not done.
+long read_deadline_ns = -1;
+long write_deadline_ns = -1;
+
+// Whether the kernels' instructions were picked with -I.
+bool isa_given = false;
+
+// How long readers and writers stay in the critical section, set with
+// -x, on top of the read or write itself.
+long cs_ns = 0;
+
+bench_result last_result;
+
+// What each reader and writer cost the machine, when -H is given.
+perf_counts *rperf;
+perf_counts *wperf;
+
+// The state of the run, in shared memory.
+struct run_state
+{
+	std::atomic<bool> stop;		// Set once the run has been ended.
+	std::atomic<int> readers_left;	// Threads of each kind still running.
+	std::atomic<int> writers_left;
+};
+run_state *run;
+
+thread_stats *rstats;
+thread_stats *wstats;
+
+// Lock wait histograms, one per reader and writer, or two per worker,
+// when -l is given.
+latency_hist *rwaits;
+latency_hist *wwaits;
+int nrwaits;
+int nwwaits;
+
+// When the readers and writers were started.
+double run_start;
+
+// Resource usage before and after the run.
+struct rusage usage_start;
+struct rusage usage_end;
+
+// Each worker's copy of the string, under an optimistic policy.
+char *pool_copies;
+
+// The locks the coroutines take instead of the policy's, one per
+// shard.
+async_rwlock *async_locks;
+
+// Size of the shared buffer, set with -s. By default it holds the text
+// once.
+size_t buffer_size = sizeof(buffer_text) - 1;
+bool size_given = false;
+
+// The file to map as the buffer, set with -f.
+const char *map_path = NULL;
+
+// Where readers write what they read, set with -w, or -1.
+int out_fd = -1;
+
+// The buffers the readers and writers share, one per shard.
+shared_buffer *shared;
+
+// Number of shards, set with -k, and the skew of the keys that pick
+// them, set with -z. A skew of 0 picks keys uniformly.
+int num_shards = 1;
+double zipf_theta = 0;
+
+// Keys readers and writers pick from. Each key lives in one shard.
+const long NUM_KEYS = 1 << 20;
+
+// Constants of the Zipf distribution, worked out by init_zipf().
+double zipf_zetan;
+double zipf_alpha;
+double zipf_eta;
+
+// Each thread's random number state.
+thread_local uint64_t rng_state;
+
+// What each thread did in each shard. Each thread has a row, padded to
+// a cache line, with one count per shard.
+struct shard_count
+{
+	long ops;		// Reads and writes.
+	long wait_ns;		// Time spent taking the lock, when -l is given.
+};
+shard_count *shard_counts;
+size_t shard_row;
+thread_local shard_count *my_counts;
+
+// Writers combine their writes, set with -c. Each writer posts its
+// write in its own slot, and whichever writer gets a shard's lock
+// applies every write posted to that shard before letting it go.
+bool combining = false;
+
+// A slot is empty, holds the shard a write was posted to, or holds
+// SLOT_BUSY - shard while a combiner applies it.
+const int SLOT_EMPTY = -1;
+const int SLOT_BUSY = -2;
+
+struct alignas(64) combine_slot
+{
+	std::atomic<int> state;
+};
+combine_slot *pub_slots;
+
+// Set while a writer is combining in each shard.
+struct alignas(64) combiner_flag
+{
+	std::atomic<bool> held;
+};
+combiner_flag *combiners;
+
+// The batches each writer applied as the combiner. Bucket b counts the
+// batches of 2^b to 2^(b+1) - 1 writes.
+const int BATCH_BUCKETS = 32;
+struct alignas(64) batch_stats
+{
+	long counts[BATCH_BUCKETS];
+	long batches;
+	long writes;
+	long max;
+};
+batch_stats *batches;
+
+// The buffer readers see in each shard under a snapshot policy.
+// Writers replace it with a new copy instead of changing shared.
+std::atomic<shared_buffer *> *snapshot;
+
+/**************************************************************************
+
+Function:	usage()
+
+Use:		Prints the usage of the program.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void usage()
+{
+	fprintf(stderr,"\n");
+	fprintf(stderr,"Usage: %s [-p policy] [-b] [-t secs] [-n ops] [-l] [-q] [-s size] [-f file] [-w out] [-P] [-m workers] [-a threads] [-k shards] [-z theta] [-c] [-S spins] [-R cpus] [-W cpus] [-N node] [-x ns] [-H] [-E code] [-F ms] [-T file] [-d ms] [-D ms] [-K kernels] [-I isa] [num_readers] [num_writers]\n",prog_name);
+	fprintf(stderr,"======================================================\n");
+	fprintf(stderr,"[num_readers] - number of reading threads.\n");
+	fprintf(stderr,"[num_writers] - number of writing threads.\n");
+	fprintf(stderr,"-p policy     - lock policy (default %s):\n",policy->name);
+	list_policies(stderr);
+	fprintf(stderr,"-b            - benchmark mode: no sleeps, report ops/sec.\n");
+	fprintf(stderr,"-t secs       - benchmark duration in seconds (default 5).\n");
+	fprintf(stderr,"-n ops        - benchmark operations per thread (overrides -t).\n");
+	fprintf(stderr,"-l            - time every lock wait and report percentiles.\n");
+	fprintf(stderr,"-q            - quiet: don't log what the threads do.\n");
+	fprintf(stderr,"-s size       - shared buffer size in bytes, k, m or g (default %zu).\n",sizeof(buffer_text) - 1);
+	fprintf(stderr,"-f file       - map a file as the shared buffer instead, at the file's size.\n");
+	fprintf(stderr,"-w out        - readers write what they read to a file, or - for stdout.\n");
+	fprintf(stderr,"-P            - run readers and writers as processes, not threads.\n");
+	fprintf(stderr,"-m workers    - run readers and writers as tasks on a pool of workers (0: one per core).\n");
+	fprintf(stderr,"-a threads    - run readers and writers as coroutines with an async lock (0: one per core).\n");
+	fprintf(stderr,"-k shards     - split the buffer into shards, each with its own lock (default 1).\n");
+	fprintf(stderr,"-z theta      - pick keys with Zipf skew theta, 0 to under 1 (default 0: uniform).\n");
+	fprintf(stderr,"-c            - writers combine their writes: one writer applies a batch per lock.\n");
+	fprintf(stderr,"-S spins      - spin up to this many times on a taken lock before sleeping (default 0).\n");
+	fprintf(stderr,"-R cpus       - pin readers to CPUs: a list like 0-3,8, nodeN for a node's CPUs, or spread.\n");
+	fprintf(stderr,"-W cpus       - pin writers the same way.\n");
+	fprintf(stderr,"-N node       - put the shared buffer and counters on this NUMA node.\n");
+	fprintf(stderr,"-x ns         - stay this long in each critical section (default 0).\n");
+	fprintf(stderr,"-H            - count cycles, cache misses and more per operation with perf_event_open().\n");
+	fprintf(stderr,"-E code       - raw perf event code that counts HITM loads on this processor.\n");
+	fprintf(stderr,"-F ms         - report each thread's longest wait and gap, and flag waits over ms (implies -l).\n");
+	fprintf(stderr,"-T file       - trace every semaphore wait and post, and write them to file as a Chrome trace.\n");
+	fprintf(stderr,"-d ms         - readers give up on the lock after ms (0: only try once).\n");
+	fprintf(stderr,"-D ms         - writers give up on the lock after ms (0: only try once).\n");
+	fprintf(stderr,"-K kernels    - work on the whole buffer in the lock: read[,write], read checksum, search\n");
+	fprintf(stderr,"                or copy, write fill or transform, such as checksum,fill.\n");
+	fprintf(stderr,"-I isa        - run the kernels with scalar, sse2 or avx2 (default: the best there is).\n");
+	fprintf(stderr,"\n");
+}
+
+/**************************************************************************
+
+Function:	now_secs()
+
+Use:		Reads the monotonic clock.
+
+Arguments:	None.
+
+Returns:	The current monotonic time in seconds.
+
+**************************************************************************/
+
+double now_secs()
+{
+	struct timespec ts;
+
+	// Read the clock. If it fails, print why.
+	if (clock_gettime(CLOCK_MONOTONIC,&ts) != 0)
+	{
+		fprintf(stderr,"clock_gettime(): %s.\n",strerror(errno));
+		exit(-1);
+	}
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**************************************************************************
+
+Function:	now_ns()
+
+Use:		Reads the monotonic clock for timing lock waits.
+
+Arguments:	None.
+
+Returns:	The current monotonic time in nanoseconds.
+
+**************************************************************************/
+
+uint64_t now_ns()
+{
+	struct timespec ts;
+
+	// Read the clock. If it fails, print why.
+	if (clock_gettime(CLOCK_MONOTONIC,&ts) != 0)
+	{
+		fprintf(stderr,"clock_gettime(): %s.\n",strerror(errno));
+		exit(-1);
+	}
+
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**************************************************************************
+
+Function:	string_empty()
+
+Use:		Checks whether the writers have emptied the string in
+		every shard. It only reads the lengths, so it doesn't
+		depend on the buffer's size.
+
+Arguments:	None.
+
+Returns:	true if the string is empty, false otherwise.
+
+**************************************************************************/
+
+bool string_empty()
+{
+	for (int k = 0; k < num_shards; k++)
+	{
+		bool empty;
+
+		// Under a snapshot policy, look at the current copy. It
+		// can only be freed once the read is over.
+		if (policy->retire != NULL)
+		{
+			policy_select(k);
+			policy->read_lock();
+			empty = snapshot[k].load()->len == 0;
+			policy->read_unlock();
+		}
+		else
+			empty = shared[k].len == 0;
+
+		if (!empty)
+			return false;
+	}
+
+	return true;
+}
+
+/**************************************************************************
+
+Function:	keep_running()
+
+Use:		Decides whether a reader or writer should do another
+		iteration.
+
+Arguments:	1. ops: The number of operations the thread has done.
+
+Returns:	true if the thread should continue, false otherwise.
+
+**************************************************************************/
+
+bool keep_running(long ops)
+{
+	// Stop once the run has been ended.
+	if (run->stop.load(std::memory_order_relaxed))
+		return false;
+
+	// Outside of benchmark mode, run until the string is empty.
+	if (!bench_mode)
+		return !string_empty();
+
+	// Stop once the operation count is reached.
+	return bench_ops == 0 || ops < bench_ops;
+}
+
+/**************************************************************************
+
+Function:	end_run()
+
+Use:		Ends the run. Threads that may be blocked for good, such
+		as readers waiting for a writer that has exited, are
+		woken so they can see the stop flag and exit.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void end_run()
+{
+	// Only the first caller wakes the threads.
+	if (run->stop.exchange(true))
+		return;
+
+	policy_release(num_readers, num_writers);
+}
+
+/**************************************************************************
+
+Function:	init_zipf()
+
+Use:		Works out the constants for drawing Zipf keys, as in
+		Gray et al., "Quickly Generating Billion-Record Synthetic
+		Databases".
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void init_zipf()
+{
+	double zeta2 = 1 + pow(0.5, zipf_theta);
+
+	zipf_zetan = 0;
+	for (long i = 1; i <= NUM_KEYS; i++)
+		zipf_zetan += 1 / pow((double) i, zipf_theta);
+	zipf_alpha = 1 / (1 - zipf_theta);
+	zipf_eta = (1 - pow(2.0 / NUM_KEYS, 1 - zipf_theta)) / (1 - zeta2 / zipf_zetan);
+}
+
+/**************************************************************************
+
+Function:	next_random()
+
+Use:		Draws a random number from the calling thread's own
+		xorshift generator, seeding it the first time.
+
+Arguments:	None.
+
+Returns:	A random 64-bit number.
+
+**************************************************************************/
+
+uint64_t next_random()
+{
+	static std::atomic<uint64_t> seeds(1);
+
+	// Give each thread its own seed.
+	if (rng_state == 0)
+		rng_state = seeds.fetch_add(1) * 0x9E3779B97F4A7C15ULL;
+
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+/**************************************************************************
+
+Function:	pick_shard()
+
+Use:		Draws a key, uniformly or from the Zipf distribution, and
+		finds the shard it lives in. Keys are scattered over the
+		shards by a hash, so the hottest keys land in different
+		shards.
+
+Arguments:	None.
+
+Returns:	The shard.
+
+**************************************************************************/
+
+int pick_shard()
+{
+	long key;
+
+	if (num_shards == 1)
+		return 0;
+
+	// Draw the key.
+	double u = (next_random() >> 11) * (1.0 / 9007199254740992.0);
+	if (zipf_theta == 0)
+		key = (long) (u * NUM_KEYS);
+	else
+	{
+		double uz = u * zipf_zetan;
+		if (uz < 1)
+			key = 0;
+		else if (uz < 1 + pow(0.5, zipf_theta))
+			key = 1;
+		else
+			key = (long) (NUM_KEYS * pow(zipf_eta * u - zipf_eta + 1, zipf_alpha));
+		if (key >= NUM_KEYS)
+			key = NUM_KEYS - 1;
+	}
+
+	// Hash it to a shard.
+	uint64_t h = (uint64_t) key * 0x9E3779B97F4A7C15ULL;
+	return (int) ((h >> 32) % num_shards);
+}
+
+/**************************************************************************
+
+Function:	use_counts()
+
+Use:		Picks the row of per-shard counts the calling thread adds
+		to.
+
+Arguments:	1. row: The row. Each reader and writer thread has its own,
+		   or each worker when a pool or executor runs them.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void use_counts(int row)
+{
+	my_counts = (shard_count *) ((char *) shard_counts + row * shard_row);
+}
+
+/**************************************************************************
+
+Function:	hold_cs()
+
+Use:		Stays in the critical section for the time given with
+		-x, spinning on the clock, to stand in for real work
+		under the lock.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void hold_cs()
+{
+	if (cs_ns == 0)
+		return;
+
+	uint64_t end = now_ns() + cs_ns;
+	while (now_ns() < end)
+		;
+}
+
+/**************************************************************************
+
+Function:	note_wait()
+
+Use:		Records a wait for the lock that just ended, when waits
+		are timed: in the shard's counts, as the thread's longest
+		wait, and as a starving wait if it was too long. It also
+		keeps the thread's longest gap between getting the lock.
+
+Arguments:	1. *st: The reader or writer's results.
+		2. k: The shard.
+		3. start: When the wait started.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void note_wait(thread_stats *st, int k, uint64_t start)
+{
+	if (!time_waits)
+		return;
+
+	uint64_t now = now_ns();
+	long wait = now - start;
+	long gap = now - st->last_ns;
+
+	my_counts[k].wait_ns += wait;
+	if (wait > st->max_wait_ns)
+		st->max_wait_ns = wait;
+	if (gap > st->max_gap_ns)
+		st->max_gap_ns = gap;
+	if (starve_ns > 0 && wait > starve_ns)
+		st->starved++;
+	st->last_ns = now;
+}
+
+/**************************************************************************
+
+Function:	read_view()
+
+Use:		Uses what a reader read: counts it, and logs it or writes
+		it out. The reader still holds the lock.
+
+Arguments:	1. id: The reader's id.
+		2. *content: What the reader read.
+		3. len: Its length.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void read_view(long id, const char *content, size_t len)
+{
+	// Count what was read, and run the reader's kernel over it,
+	// keeping what it made so the work is done.
+	rstats[id].bytes += len;
+	if (read_kernel != READ_NONE)
+		rstats[id].digest += kernel_read(content,len);
+
+	// Do the rest of the reader's work.
+	hold_cs();
+
+	// Stream the view to the output, straight from the buffer.
+	if (out_fd >= 0)
+	{
+		write_view(out_fd,content,len);
+	}
+	// Checks if the string is empty. That way, it doesn't print
+	// an empty string.
+	else if (len != 0)
+	{
+		// Log value of string.
+		log_event(LOG_READING,id,len,content);
+	}
+}
+
+/**************************************************************************
+
+Function:	read_once()
+
+Use:		Does one read. The reader picks a shard, takes its lock,
+		logs or writes out what it reads and releases the lock.
+
+Arguments:	1. id: The reader's id.
+		2. *copy: Room for the reader's copy of the string, under
+		   an optimistic policy.
+
+Returns:	false if the run ended while the reader waited, true
+		otherwise.
+
+**************************************************************************/
+
+bool read_once(long id, char *copy)
+{
+	// Pick the shard, and work on its lock.
+	int k = pick_shard();
+	shared_buffer *buf = &shared[k];
+	policy_select(k);
+	// What the reader reads, and its length.
+	const char *content = buf->data;
+	size_t len;
+	// Time taking the lock started.
+	uint64_t start = time_waits ? now_ns() : 0;
+
+	// Under an optimistic policy, copy the string without
+	// locking, and copy it again if a writer got in.
+	if (policy->read_begin != NULL)
+	{
+		unsigned seq = policy->read_begin();
+		note_wait(&rstats[id],k,start);
+		len = buf->len.load(std::memory_order_relaxed);
+		memcpy(copy,buf->data,len);
+		while (policy->read_retry(seq))
+		{
+			rstats[id].retries++;
+			seq = policy->read_begin();
+			len = buf->len.load(std::memory_order_relaxed);
+			memcpy(copy,buf->data,len);
+		}
+		content = copy;
+	}
+	else
+	{
+		// Take the lock for reading, by the deadline if there is
+		// one. A reader that misses it counts the miss and goes on.
+		if (read_deadline_ns < 0)
+			policy->read_lock();
+		else if (!policy->read_lock_until(now_ns() + read_deadline_ns))
+		{
+			rstats[id].missed++;
+			return !run->stop;
+		}
+		note_wait(&rstats[id],k,start);
+
+		// If the run ended while waiting, leave.
+		if (run->stop)
+		{
+			policy->read_unlock();
+			return false;
+		}
+
+		// Under a snapshot policy, read the current copy.
+		if (policy->retire != NULL)
+		{
+			shared_buffer *b = snapshot[k].load();
+			content = b->data;
+			len = b->len;
+		}
+		else
+			len = buf->len;
+	}
+
+	// Use what was read.
+	read_view(id,content,len);
+
+	// Release the lock.
+	if (policy->read_begin == NULL)
+		policy->read_unlock();
+
+	// Count the read.
+	rstats[id].ops++;
+	my_counts[k].ops++;
+
+	return true;
+}
+
+/**************************************************************************
+
+Function:	reader_done()
+
+Use:		Records that a reader is done.
+
+Arguments:	1. id: The reader's id.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void reader_done(long id)
+{
+	// Under a policy where readers and writers take turns, the
+	// writers can't go on once every reader is done, or once the
+	// string is empty, so end the run.
+	if (--run->readers_left == 0 || !bench_mode)
+		if (policy->alternates)
+			end_run();
+
+	// Notify to user that the reader is exiting.
+	log_event(LOG_READER_EXIT,id,0,NULL);
+}
+
+/**************************************************************************
+
+Function:	reader()
+
+Use:		The reader thread. It prints the value of
+		the shared string.
+
+Arguments:	1. *param: The id sent to the reader thread by
+		           pthread_create().
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void *reader(void *param)
+{
+	// Get the thread's id.
+	long id = (long) param;
+	// The reader's copy of the string, under an optimistic policy.
+	char *copy = NULL;
+	// Time the loop started.
+	double start = now_secs();
+
+	// Record lock waits in this reader's histogram, and its work in
+	// each shard in its own row.
+	if (time_waits)
+		wait_hist = &rwaits[id];
+	use_counts(id);
+	if (trace_path != NULL)
+		trace_attach(id);
+
+	// Under an optimistic policy, make room for the copy.
+	if (policy->read_begin != NULL)
+	{
+		copy = (char *) malloc(shared[0].size + 1);
+		if (copy == NULL)
+		{
+			fprintf(stderr,"malloc(): reader %ld copy - %s.\n",id,strerror(errno));
+			exit(-1);
+		}
+	}
+
+	// Start counting what the loop costs.
+	perf_group counters;
+	if (perf_on)
+		perf_begin(&counters);
+
+	// Loop while the string is not empty, or until the benchmark ends.
+	while(keep_running(rstats[id].ops) && read_once(id,copy))
+	{
+		// Sleep for 1 second, unless benchmarking.
+		if(!bench_mode && sleep(1) != 0)
+		{
+			// Print error on fail.
+			fprintf(stderr,"sleep(): %s.\n",strerror(errno));
+			exit(-1);
+		}
+	}
+
+	// Record how long the reader ran, and what it cost.
+	rstats[id].secs = now_secs() - start;
+	if (perf_on)
+		perf_end(&counters,&rperf[id]);
+	free(copy);
+
+	// The reader is done.
+	reader_done(id);
+	// Exit thread.
+	pthread_exit(0);
+}
+
+/**************************************************************************
+
+Function:	change_buffer()
+
+Use:		Chops the last letter off a buffer, or refills it in
+		benchmark mode once it is empty. The writer holds the
+		lock.
+
+Arguments:	1. id: The writer's id.
+		2. *target: The buffer.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void change_buffer(long id, shared_buffer *target)
+{
+	// Do the rest of the writer's work.
+	hold_cs();
+
+	// In benchmark mode, refill the string once it is empty so
+	// the writers always have work.
+	if (bench_mode && target->len == 0)
+	{
+		buffer_refill(target);
+	}
+	// Check again if the string is empty. This is so that
+	// there isn't needless writing if it is.
+	else if (target->len != 0)
+	{
+		// Log that the writer is writing.
+		log_event(LOG_WRITING,id,0,NULL);
+		// Run the writer's kernel over the text, and count it.
+		if (write_kernel != WRITE_NONE)
+		{
+			size_t len = target->len.load(std::memory_order_relaxed);
+			kernel_write(target->data,len,wstats[id].ops);
+			wstats[id].bytes += len;
+		}
+		// Chop off the last character.
+		buffer_chop(target);
+	}
+}
+
+/**************************************************************************
+
+Function:	write_once()
+
+Use:		Does one write. The writer picks a shard, takes its
+		lock, chops the last letter off the string, or refills
+		it in benchmark mode, and releases the lock.
+
+Arguments:	1. id: The writer's id.
+
+Returns:	false if the run ended while the writer waited, true
+		otherwise.
+
+**************************************************************************/
+
+bool write_once(long id)
+{
+	// Pick the shard, and work on its lock.
+	int k = pick_shard();
+	policy_select(k);
+	// Time taking the lock started.
+	uint64_t start = time_waits ? now_ns() : 0;
+
+	// Take the lock for writing, by the deadline if there is one. A
+	// writer that misses it counts the miss and goes on.
+	if (write_deadline_ns < 0)
+		policy->write_lock();
+	else if (!policy->write_lock_until(now_ns() + write_deadline_ns))
+	{
+		wstats[id].missed++;
+		return !run->stop;
+	}
+	note_wait(&wstats[id],k,start);
+
+	// If the run ended while waiting, leave.
+	if (run->stop)
+	{
+		policy->write_unlock();
+		return false;
+	}
+
+	// The buffer to write. Under a snapshot policy, it is a new
+	// copy of the current one.
+	shared_buffer *target = &shared[k];
+	if (policy->retire != NULL)
+		target = buffer_dup(snapshot[k].load());
+
+	// Change it.
+	change_buffer(id,target);
+
+	// Publish the new copy and retire the old one.
+	if (policy->retire != NULL)
+		policy->retire(snapshot[k].exchange(target));
+
+	// Release the lock.
+	policy->write_unlock();
+
+	// Count the write.
+	wstats[id].ops++;
+	my_counts[k].ops++;
+
+	return true;
+}
+
+/**************************************************************************
+
+Function:	combine()
+
+Use:		Applies every write posted to a shard in one pass under
+		its lock. The caller is the shard's combiner. The writes
+		are marked done only once the lock is released, so a
+		writer never sees its write done before readers can.
+
+Arguments:	1. id: The combining writer's id.
+		2. k: The shard.
+
+Returns:	false if the run ended while the combiner waited, true
+		otherwise.
+
+**************************************************************************/
+
+bool combine(long id, int k)
+{
+	policy_select(k);
+
+	// Take the lock for writing.
+	policy->write_lock();
+
+	// If the run ended while waiting, leave.
+	if (run->stop)
+	{
+		policy->write_unlock();
+		return false;
+	}
+
+	// The buffer to write. Under a snapshot policy, it is a new
+	// copy of the current one, which takes the whole batch.
+	shared_buffer *target = &shared[k];
+	if (policy->retire != NULL)
+		target = buffer_dup(snapshot[k].load());
+
+	// Claim and apply each write posted to the shard.
+	long n = 0;
+	for (int w = 0; w < num_writers; w++)
+	{
+		int posted = k;
+		if (pub_slots[w].state.load(std::memory_order_relaxed) == k &&
+		    pub_slots[w].state.compare_exchange_strong(posted, SLOT_BUSY - k))
+		{
+			change_buffer(w,target);
+			n++;
+		}
+	}
+
+	// Publish the new copy and retire the old one.
+	if (policy->retire != NULL)
+		policy->retire(snapshot[k].exchange(target));
+
+	// Release the lock.
+	policy->write_unlock();
+
+	// Tell the writers their writes are done.
+	for (int w = 0; w < num_writers; w++)
+		if (pub_slots[w].state.load(std::memory_order_relaxed) == SLOT_BUSY - k)
+			pub_slots[w].state.store(SLOT_EMPTY, std::memory_order_release);
+
+	// A pass that found nothing posted isn't a batch.
+	if (n == 0)
+		return true;
+
+	// Count the batch by its size.
+	batch_stats *b = &batches[id];
+	int bucket = 63 - __builtin_clzl(n);
+	b->counts[bucket < BATCH_BUCKETS ? bucket : BATCH_BUCKETS - 1]++;
+	b->batches++;
+	b->writes += n;
+	if (n > b->max)
+		b->max = n;
+
+	return true;
+}
+
+/**************************************************************************
+
+Function:	combine_once()
+
+Use:		Does one write by flat combining. The writer picks a
+		shard and posts its write in its slot. Then, until the
+		write is done, it becomes the shard's combiner if no one
+		else is, or waits for the combiner to apply it.
+
+Arguments:	1. id: The writer's id.
+
+Returns:	false if the run ended before the write was done, true
+		otherwise.
+
+**************************************************************************/
+
+bool combine_once(long id)
+{
+	// Pick the shard.
+	int k = pick_shard();
+	combine_slot *mine = &pub_slots[id];
+	// Time the write was posted.
+	uint64_t start = time_waits ? now_ns() : 0;
+
+	// The wait is timed from posting the write to it being done,
+	// not around the lock, which most writers never take.
+	latency_hist *hist = wait_hist;
+	wait_hist = NULL;
+
+	// Post the write.
+	mine->state.store(k, std::memory_order_release);
+
+	for (;;)
+	{
+		int state = mine->state.load(std::memory_order_acquire);
+
+		// A combiner has applied the write.
+		if (state == SLOT_EMPTY)
+			break;
+
+		// If the run ended, take the write back, unless a combiner
+		// is applying it.
+		if (run->stop)
+		{
+			int posted = k;
+			if (mine->state.compare_exchange_strong(posted, SLOT_EMPTY))
+			{
+				wait_hist = hist;
+				return false;
+			}
+		}
+		// Become the combiner if the shard has none.
+		else if (state == k && !combiners[k].held.load(std::memory_order_relaxed) &&
+			 !combiners[k].held.exchange(true, std::memory_order_acquire))
+		{
+			// The last combiner may have applied the write
+			// already, and then there's nothing to take the
+			// lock for.
+			if (mine->state.load(std::memory_order_acquire) == k)
+				combine(id,k);
+			combiners[k].held.store(false, std::memory_order_release);
+			continue;
+		}
+
+		// Let the combiner run.
+		sched_yield();
+	}
+
+	// Record the wait.
+	wait_hist = hist;
+	if (wait_hist != NULL)
+		hist_record(wait_hist, now_ns() - start);
+	note_wait(&wstats[id],k,start);
+
+	// Count the write.
+	wstats[id].ops++;
+	my_counts[k].ops++;
+
+	return true;
+}
+
+/**************************************************************************
+
+Function:	writer_done()
+
+Use:		Records that a writer is done.
+
+Arguments:	1. id: The writer's id.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void writer_done(long id)
+{
+	// Under a policy where readers and writers take turns, the
+	// readers can't go on once every writer is done, or once the
+	// string is empty, so end the run.
+	if (--run->writers_left == 0 || !bench_mode)
+		if (policy->alternates)
+			end_run();
+
+	// Notify to user that the writer is exiting.
+	log_event(LOG_WRITER_EXIT,id,0,NULL);
+}
+
+/**************************************************************************
+
+Function:	writer()
+
+Use:		The writer thread. It chops of the last letter of the
+		string.
+
+Arguments:	1. *param: The id sent to the writer thread by
+		           pthread_create().
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void *writer(void *param)
+{
+	// Get the thread's id.
+	long id = (long) param;
+	// Time the loop started.
+	double start = now_secs();
+
+	// Record lock waits in this writer's histogram, and its work in
+	// each shard in its own row.
+	if (time_waits)
+		wait_hist = &wwaits[id];
+	use_counts(num_readers + id);
+	if (trace_path != NULL)
+		trace_attach(num_readers + id);
+
+	// Start counting what the loop costs.
+	perf_group counters;
+	if (perf_on)
+		perf_begin(&counters);
+
+	// Loop while the string isn't empty, or until the benchmark ends.
+	while (keep_running(wstats[id].ops) && (combining ? combine_once(id) : write_once(id)))
+	{
+		// Sleep for 1 second, unless benchmarking.
+		if (!bench_mode && sleep(1) != 0)
+		{
+			// Print error on fail.
+			fprintf(stderr,"sleep(): %s.\n",strerror(errno));
+			exit(-1);
+		}
+	}
+
+	// Record how long the writer ran, and what it cost.
+	wstats[id].secs = now_secs() - start;
+	if (perf_on)
+		perf_end(&counters,&wperf[id]);
+
+	// The writer is done.
+	writer_done(id);
+	// Exit thread.
+	pthread_exit(0);
+}
+
+/**************************************************************************
+
+Function:	task_step()
+
+Use:		Runs one step of a logical reader or writer on a pool
+		worker: one read or write, without sleeping. The readers
+		are tasks 0 to num_readers - 1, and the writers come
+		after them.
+
+Arguments:	1. task: The task.
+
+Returns:	true if the reader or writer has more to do, false once
+		it is done.
+
+**************************************************************************/
+
+bool task_step(long task)
+{
+	int worker = pool_worker();
+
+	// Count the work in each shard in the worker's row.
+	use_counts(worker);
+
+	// Run a reader, timing its waits in the worker's histogram.
+	if (task < num_readers)
+	{
+		long id = task;
+		if (time_waits)
+			wait_hist = &rwaits[worker];
+		if (keep_running(rstats[id].ops) &&
+		    read_once(id,pool_copies + worker * (shared[0].size + 1)))
+			return true;
+
+		rstats[id].secs = now_secs() - run_start;
+		reader_done(id);
+		return false;
+	}
+
+	// Or run a writer.
+	long id = task - num_readers;
+	if (time_waits)
+		wait_hist = &wwaits[worker];
+	if (keep_running(wstats[id].ops) && write_once(id))
+		return true;
+
+	wstats[id].secs = now_secs() - run_start;
+	writer_done(id);
+	return false;
+}
+
+/**************************************************************************
+
+Function:	reader_co()
+
+Use:		A reader coroutine. It reads like a reader thread, but
+		co_awaits the asynchronous lock and yields to the other
+		coroutines between reads instead of sleeping.
+
+Arguments:	1. id: The reader's id.
+
+Returns:	The coroutine.
+
+**************************************************************************/
+
+coro_task reader_co(long id)
+{
+	// Loop while the string is not empty, or until the benchmark ends.
+	while (keep_running(rstats[id].ops))
+	{
+		// Pick the shard.
+		int k = pick_shard();
+
+		// Take its lock for reading, timing the wait.
+		uint64_t start = time_waits ? now_ns() : 0;
+		co_await async_lock_shared(&async_locks[k]);
+		if (time_waits)
+			hist_record(&rwaits[coro_worker()], now_ns() - start);
+
+		// The coroutine may have moved to another thread, so count
+		// its work in that thread's row.
+		use_counts(coro_worker());
+		note_wait(&rstats[id],k,start);
+
+		// If the run ended while waiting, leave.
+		if (run->stop)
+		{
+			async_unlock_shared(&async_locks[k]);
+			break;
+		}
+
+		// Read the string, then release the lock.
+		read_view(id,shared[k].data,shared[k].len);
+		async_unlock_shared(&async_locks[k]);
+
+		// Count the read, and let the others run.
+		rstats[id].ops++;
+		my_counts[k].ops++;
+		co_await coro_yield();
+	}
+
+	// Record how long the reader ran.
+	rstats[id].secs = now_secs() - run_start;
+
+	// The reader is done.
+	run->readers_left--;
+	log_event(LOG_READER_EXIT,id,0,NULL);
+}
+
+/**************************************************************************
+
+Function:	writer_co()
+
+Use:		A writer coroutine. It writes like a writer thread, but
+		co_awaits the asynchronous lock and yields to the other
+		coroutines between writes instead of sleeping.
+
+Arguments:	1. id: The writer's id.
+
+Returns:	The coroutine.
+
+**************************************************************************/
+
+coro_task writer_co(long id)
+{
+	// Loop while the string isn't empty, or until the benchmark ends.
+	while (keep_running(wstats[id].ops))
+	{
+		// Pick the shard.
+		int k = pick_shard();
+
+		// Take its lock for writing, timing the wait.
+		uint64_t start = time_waits ? now_ns() : 0;
+		co_await async_lock(&async_locks[k]);
+		if (time_waits)
+			hist_record(&wwaits[coro_worker()], now_ns() - start);
+
+		// The coroutine may have moved to another thread, so count
+		// its work in that thread's row.
+		use_counts(coro_worker());
+		note_wait(&wstats[id],k,start);
+
+		// If the run ended while waiting, leave.
+		if (run->stop)
+		{
+			async_unlock(&async_locks[k]);
+			break;
+		}
+
+		// Change the string, then release the lock.
+		change_buffer(id,&shared[k]);
+		async_unlock(&async_locks[k]);
+
+		// Count the write, and let the others run.
+		wstats[id].ops++;
+		my_counts[k].ops++;
+		co_await coro_yield();
+	}
+
+	// Record how long the writer ran.
+	wstats[id].secs = now_secs() - run_start;
+
+	// The writer is done.
+	run->writers_left--;
+	log_event(LOG_WRITER_EXIT,id,0,NULL);
+}
+
+/**************************************************************************
+
+Function:	check_args()
+
+Use:		Checks the arguments passed to the program, and
+		verifies that they are valid numbers.
+
+Arguments:	1. argc: The number of arguments.
+		2. *argv[]: A char * string that holds the arguments.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void check_args(int argc, char *argv[])
+{
+	int opt;
+	long deadline;
+
+	// Read the options.
+	while ((opt = getopt(argc, argv, "p:bt:n:lqs:f:w:Pm:a:k:z:cS:R:W:N:x:HE:F:T:d:D:K:I:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'p':
+			// Look up the lock policy.
+			if (find_policy(optarg) == NULL)
+			{
+				fprintf(stderr,"unknown lock policy: %s.\n",optarg);
+				usage();
+				exit(-1);
+			}
+			policy = find_policy(optarg);
+			policy_given = true;
+			break;
+		case 'b':
+			// Turn on benchmark mode.
+			bench_mode = true;
+			break;
+		case 't':
+			// Read the duration, which must be positive.
+			bench_secs = atoi(optarg);
+			if (bench_secs <= 0)
+			{
+				fprintf(stderr,"benchmark duration must be greater than 0.\n");
+				exit(-1);
+			}
+			break;
+		case 'n':
+			// Read the operation count, which must be positive.
+			bench_ops = atol(optarg);
+			if (bench_ops <= 0)
+			{
+				fprintf(stderr,"benchmark operation count must be greater than 0.\n");
+				exit(-1);
+			}
+			break;
+		case 'l':
+			// Time the lock waits.
+			time_waits = true;
+			break;
+		case 'q':
+			// Turn off logging.
+			log_quiet = true;
+			break;
+		case 's':
+			// Read the buffer size, which must be positive.
+			buffer_size = parse_size(optarg);
+			if (buffer_size == 0)
+			{
+				fprintf(stderr,"buffer size must be a number of bytes, k, m or g.\n");
+				exit(-1);
+			}
+			size_given = true;
+			break;
+		case 'f':
+			// Map this file as the buffer.
+			map_path = optarg;
+			break;
+		case 'w':
+			// Open the readers' output.
+			if (strcmp(optarg, "-") == 0)
+				out_fd = STDOUT_FILENO;
+			else if ((out_fd = open(optarg, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+			{
+				fprintf(stderr,"open(): %s - %s.\n",optarg,strerror(errno));
+				exit(-1);
+			}
+			break;
+		case 'P':
+			// Fork processes instead of creating threads.
+			process_mode = true;
+			break;
+		case 'm':
+			// Read the number of workers, or 0 for one per core.
+			pool_mode = true;
+			pool_workers = atoi(optarg);
+			if (pool_workers < 0)
+			{
+				fprintf(stderr,"number of workers can't be negative.\n");
+				exit(-1);
+			}
+			if (pool_workers == 0)
+				pool_workers = pool_cores();
+			break;
+		case 'a':
+			// Read the number of executor threads, or 0 for one per
+			// core.
+			coro_mode = true;
+			coro_workers = atoi(optarg);
+			if (coro_workers < 0)
+			{
+				fprintf(stderr,"number of executor threads can't be negative.\n");
+				exit(-1);
+			}
+			if (coro_workers == 0)
+				coro_workers = pool_cores();
+			break;
+		case 'k':
+			// Read the number of shards, which must be positive.
+			num_shards = atoi(optarg);
+			if (num_shards <= 0)
+			{
+				fprintf(stderr,"number of shards must be greater than 0.\n");
+				exit(-1);
+			}
+			break;
+		case 'z':
+			// Read the skew, which must be from 0 to under 1.
+			zipf_theta = atof(optarg);
+			if (zipf_theta < 0 || zipf_theta >= 1)
+			{
+				fprintf(stderr,"zipf theta must be from 0 to under 1.\n");
+				exit(-1);
+			}
+			break;
+		case 'c':
+			// Combine the writes.
+			combining = true;
+			break;
+		case 'S':
+			// Read the spin limit, which can't be negative.
+			spin_max = atoi(optarg);
+			if (spin_max < 0)
+			{
+				fprintf(stderr,"spin limit can't be negative.\n");
+				exit(-1);
+			}
+			break;
+		case 'R':
+		case 'W':
+			// Read the CPUs to pin readers or writers to.
+			if (!place_parse(optarg, opt == 'R' ? &reader_cpus : &writer_cpus))
+			{
+				fprintf(stderr,"%s isn't a list of online CPUs, nodeN or spread.\n",optarg);
+				exit(-1);
+			}
+			break;
+		case 'x':
+			// Read the critical section length, which can't be
+			// negative.
+			cs_ns = atol(optarg);
+			if (cs_ns < 0)
+			{
+				fprintf(stderr,"critical section length can't be negative.\n");
+				exit(-1);
+			}
+			break;
+		case 'F':
+			// Read the starvation bound, which must be positive,
+			// and time the waits.
+			fair_mode = true;
+			time_waits = true;
+			starve_ns = (long) (atof(optarg) * 1000000);
+			if (starve_ns <= 0)
+			{
+				fprintf(stderr,"starvation bound must be greater than 0.\n");
+				exit(-1);
+			}
+			break;
+		case 'd':
+		case 'D':
+			// Read the deadline, which can't be negative.
+			deadline = (long) (atof(optarg) * 1000000);
+			if (deadline < 0)
+			{
+				fprintf(stderr,"deadline can't be negative.\n");
+				exit(-1);
+			}
+			if (opt == 'd')
+				read_deadline_ns = deadline;
+			else
+				write_deadline_ns = deadline;
+			break;
+		case 'K':
+			// Read the reader's and writer's kernels.
+			if (!kernel_parse(optarg))
+			{
+				fprintf(stderr,"kernels must be read[,write]: checksum, search or copy, and fill or transform.\n");
+				exit(-1);
+			}
+			break;
+		case 'I':
+			// Pick the instructions the kernels run with.
+			if (!kernel_use_isa(optarg))
+			{
+				fprintf(stderr,"isa must be scalar, sse2 or avx2, and one this processor has.\n");
+				exit(-1);
+			}
+			isa_given = true;
+			break;
+		case 'T':
+			// Trace the semaphores into this file.
+			trace_path = optarg;
+			break;
+		case 'H':
+			// Count hardware events.
+			perf_on = true;
+			break;
+		case 'E':
+			// Read the raw HITM event, in any base.
+			perf_hitm = strtoul(optarg, NULL, 0);
+			break;
+		case 'N':
+			// Read the node, which must exist.
+			shm_node = atoi(optarg);
+			if (shm_node < 0 || shm_node >= place_nodes())
+			{
+				fprintf(stderr,"node must be from 0 to %d.\n",place_nodes() - 1);
+				exit(-1);
+			}
+			break;
+		default:
+			// Print the usage then exit.
+			usage();
+			exit(-1);
+		}
+	}
+
+	// Check if there are not 2 arguments left.
+	if (argc - optind != 2)
+	{
+		// Print the usage then exit.
+		usage();
+		exit(-1);
+	}
+
+	// Some policies keep state only threads can share, such as
+	// snapshots freed with free().
+	if (process_mode && policy->threads_only)
+	{
+		fprintf(stderr,"the %s policy can't run with -P.\n",policy->name);
+		exit(-1);
+	}
+
+	// Workers can't take turns with each other, as the readers and
+	// writers are never waiting in a queue of their own.
+	if (pool_mode && policy->alternates)
+	{
+		fprintf(stderr,"the %s policy can't run with -m.\n",policy->name);
+		exit(-1);
+	}
+
+	// Taking turns in one shard would wait on a writer that may never
+	// pick it.
+	if (num_shards > 1 && policy->alternates)
+	{
+		fprintf(stderr,"the %s policy can't run with -k.\n",policy->name);
+		exit(-1);
+	}
+
+	// A mapped file's size is the buffer's size.
+	if (size_given && map_path != NULL)
+	{
+		fprintf(stderr,"-s and -f can't be used together.\n");
+		exit(-1);
+	}
+
+	// A worker pool runs in one process.
+	if (pool_mode && process_mode)
+	{
+		fprintf(stderr,"-m and -P can't be used together.\n");
+		exit(-1);
+	}
+
+	// Coroutines take their own lock, in one process.
+	if (coro_mode && (policy_given || pool_mode || process_mode))
+	{
+		fprintf(stderr,"-a can't be used with -p, -m or -P.\n");
+		exit(-1);
+	}
+
+	// A combining writer waits on its slot, so it needs a thread or
+	// process of its own.
+	if (combining && (pool_mode || coro_mode))
+	{
+		fprintf(stderr,"-c can't be used with -m or -a.\n");
+		exit(-1);
+	}
+
+	// The counters follow a reader or writer's thread.
+	if (perf_on && (pool_mode || coro_mode))
+	{
+		fprintf(stderr,"-H can't be used with -m or -a.\n");
+		exit(-1);
+	}
+
+	// Requests with deadlines need a policy that can give up, taken
+	// by readers and writers of their own.
+	if ((read_deadline_ns >= 0 || write_deadline_ns >= 0) && (pool_mode || coro_mode || combining))
+	{
+		fprintf(stderr,"-d and -D can't be used with -m, -a or -c.\n");
+		exit(-1);
+	}
+	if ((read_deadline_ns >= 0 && policy->read_lock_until == NULL) ||
+	    (write_deadline_ns >= 0 && policy->write_lock_until == NULL))
+	{
+		fprintf(stderr,"policy %s can't be taken by a deadline.\n",policy->name);
+		exit(-1);
+	}
+
+	// The instructions only matter to a kernel.
+	if (isa_given && read_kernel == READ_NONE && write_kernel == WRITE_NONE)
+	{
+		fprintf(stderr,"-I can't be used without -K.\n");
+		exit(-1);
+	}
+	kernel_setup();
+
+	// The trace follows a reader or writer's thread too.
+	if (trace_path != NULL && (pool_mode || coro_mode))
+	{
+		fprintf(stderr,"-T can't be used with -m or -a.\n");
+		exit(-1);
+	}
+
+	// Only readers and writers with threads or processes of their
+	// own can be pinned.
+	if ((reader_cpus.count > 0 || writer_cpus.count > 0) && (pool_mode || coro_mode))
+	{
+		fprintf(stderr,"-R and -W can't be used with -m or -a.\n");
+		exit(-1);
+	}
+
+	// Benchmarks don't log.
+	if (bench_mode)
+		log_quiet = true;
+
+	num_readers = atoi(argv[optind]);
+	num_writers = atoi(argv[optind + 1]);
+
+	// Check if the first argument is under 0.
+	if (num_readers < 0)
+	{
+		// Print error.
+		fprintf(stderr,"number of readers must be greater than 0.\n");
+		exit(-1);
+	}
+	// Else, check if it equals 0.
+	else if (num_readers == 0)
+	{
+		// Print error.
+		fprintf(stderr,"number of readers must be a valid number.\n");
+		exit(-1);
+	}
+
+	// Check if the second is under 0.
+	if (num_writers < 0)
+	{
+		// Print error.
+		fprintf(stderr,"number of writers must be greater than 0.\n");
+		exit(-1);
+	}
+	// Else, check if it equals 0.
+	else if (num_writers == 0)
+	{
+		// Print error.
+		fprintf(stderr,"number of writers must be a valid number.\n");
+		exit(-1);
+	}
+
+	// Count the threads that will take the lock.
+	if (coro_mode)
+		num_threads = coro_workers;
+	else if (pool_mode)
+		num_threads = pool_workers;
+	else
+		num_threads = num_readers + num_writers;
+}
+
+/**************************************************************************
+
+Function:	init_vars()
+
+Use:		Initializes the global variables.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void init_vars()
+{
+	// Initialize the lock policy, with a lock for each shard.
+	policy_init(num_shards);
+
+	// Allocate the run state and the buffers' headers where every
+	// reader and writer can see them.
+	run = new (shared_alloc(sizeof(run_state))) run_state();
+	shared = (shared_buffer *) shared_alloc(num_shards * sizeof(shared_buffer));
+
+	for (int k = 0; k < num_shards; k++)
+	{
+		// Map the file, or fill the shard's buffer.
+		new (&shared[k]) shared_buffer();
+		if (map_path != NULL)
+			buffer_map(&shared[k], map_path);
+		else
+			buffer_init(&shared[k], buffer_size);
+	}
+
+	// Under a snapshot policy, the first copy is the full buffer.
+	if (policy->retire != NULL)
+	{
+		snapshot = new (std::nothrow) std::atomic<shared_buffer *>[num_shards];
+		if (snapshot == NULL)
+		{
+			fprintf(stderr,"new: snapshots - %s.\n",strerror(ENOMEM));
+			exit(-1);
+		}
+		for (int k = 0; k < num_shards; k++)
+			snapshot[k] = buffer_dup(&shared[k]);
+	}
+
+	// The coroutines take a lock of their own in each shard.
+	if (coro_mode)
+	{
+		async_locks = new (std::nothrow) async_rwlock[num_shards]();
+		if (async_locks == NULL)
+		{
+			fprintf(stderr,"new: async locks - %s.\n",strerror(ENOMEM));
+			exit(-1);
+		}
+	}
+
+	// Work out the key distribution.
+	if (zipf_theta > 0)
+		init_zipf();
+
+	// Every thread is running at the start.
+	run->readers_left = num_readers;
+	run->writers_left = num_writers;
+
+	// Allocate the per-thread results.
+	rstats = (thread_stats *) shared_alloc(num_readers * sizeof(thread_stats));
+	wstats = (thread_stats *) shared_alloc(num_writers * sizeof(thread_stats));
+
+	// Allocate the wait histograms. Each worker or executor thread
+	// keeps its own, as the readers and writers it runs share it.
+	if (time_waits)
+	{
+		nrwaits = pool_mode || coro_mode ? num_threads : num_readers;
+		nwwaits = pool_mode || coro_mode ? num_threads : num_writers;
+		rwaits = (latency_hist *) shared_alloc(nrwaits * sizeof(latency_hist));
+		wwaits = (latency_hist *) shared_alloc(nwwaits * sizeof(latency_hist));
+	}
+
+	// Allocate the performance counts.
+	if (perf_on)
+	{
+		rperf = (perf_counts *) shared_alloc(num_readers * sizeof(perf_counts));
+		wperf = (perf_counts *) shared_alloc(num_writers * sizeof(perf_counts));
+	}
+
+	// Make every reader and writer a trace buffer.
+	if (trace_path != NULL)
+		trace_init(num_readers + num_writers);
+
+	// Allocate the per-shard counts, a row for each thread, pool
+	// worker or executor thread.
+	shard_row = (num_shards * sizeof(shard_count) + 63) & ~(size_t) 63;
+	shard_counts = (shard_count *) shared_alloc(num_threads * shard_row);
+
+	// Allocate the writers' slots, the shards' combiner flags and
+	// the batch counts.
+	if (combining)
+	{
+		pub_slots = (combine_slot *) shared_alloc(num_writers * sizeof(combine_slot));
+		for (int w = 0; w < num_writers; w++)
+			pub_slots[w].state = SLOT_EMPTY;
+		combiners = (combiner_flag *) shared_alloc(num_shards * sizeof(combiner_flag));
+		batches = (batch_stats *) shared_alloc(num_writers * sizeof(batch_stats));
+	}
+
+	// Give each worker room for a copy of the string.
+	if (pool_mode && policy->read_begin != NULL)
+	{
+		pool_copies = (char *) malloc(pool_workers * (shared[0].size + 1));
+		if (pool_copies == NULL)
+		{
+			fprintf(stderr,"malloc(): worker copies - %s.\n",strerror(errno));
+			exit(-1);
+		}
+	}
+}
+
+/**************************************************************************
+
+Function:	print_stats()
+
+Use:		Prints the per-thread and total throughput of one kind of
+		thread.
+
+Arguments:	1. *name: "reader" or "writer".
+		2. *stats: The per-thread results.
+		3. count: The number of threads.
+		4. wall: The length of the run in seconds.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void print_stats(const char *name, thread_stats *stats, int count, double wall)
+{
+	long total = 0;
+
+	// Print each thread's operations and rate. A worker pool or
+	// executor runs too many readers and writers to list.
+	for (int i = 0; i < count; i++)
+	{
+		if (!pool_mode && !coro_mode)
+			printf("%s %d: %ld ops in %.3f s, %.0f ops/sec\n",name,i,stats[i].ops,stats[i].secs,
+		       stats[i].secs > 0 ? stats[i].ops / stats[i].secs : 0.0);
+		total += stats[i].ops;
+	}
+
+	// Print the total over the whole run.
+	printf("%s total: %ld ops, %.0f ops/sec\n",name,total,wall > 0 ? total / wall : 0.0);
+}
+
+/**************************************************************************
+
+Function:	jain_sums()
+
+Use:		Adds up the threads' rates, and their squares, for
+		Jain's fairness index.
+
+Arguments:	1. *stats: The readers' or writers' results.
+		2. count: How many there are.
+		3. *sum: What to add the rates to.
+		4. *sum_sq: What to add their squares to.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void jain_sums(const thread_stats *stats, int count, double *sum, double *sum_sq)
+{
+	for (int i = 0; i < count; i++)
+	{
+		double rate = stats[i].secs > 0 ? stats[i].ops / stats[i].secs : 0;
+		*sum += rate;
+		*sum_sq += rate * rate;
+	}
+}
+
+/**************************************************************************
+
+Function:	jain_index()
+
+Use:		Works out Jain's fairness index from the sums of the
+		rates: 1 when every thread ran at the same rate, down to
+		1/n when one thread did all the work.
+
+Arguments:	1. sum: The sum of the rates.
+		2. sum_sq: The sum of their squares.
+		3. n: The number of threads.
+
+Returns:	The index, or -1 if no thread did any work, as then
+		the side starved and there is nothing to share.
+
+**************************************************************************/
+
+double jain_index(double sum, double sum_sq, int n)
+{
+	return sum_sq > 0 ? sum * sum / (n * sum_sq) : -1;
+}
+
+/**************************************************************************
+
+Function:	print_jain()
+
+Use:		Prints one side's Jain's index, or that it starved.
+
+Arguments:	1. *name: "readers" or "writers".
+		2. index: The index from jain_index().
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void print_jain(const char *name, double index)
+{
+	if (index < 0)
+		printf("%s n/a (starved: no ops)",name);
+	else
+		printf("%s %.3f",name,index);
+}
+
+/**************************************************************************
+
+Function:	longest_gap()
+
+Use:		Finds a thread's longest gap between getting the lock,
+		counting the time from its last time to when it stopped.
+
+Arguments:	1. *st: The reader or writer's results.
+
+Returns:	The gap in ns.
+
+**************************************************************************/
+
+long longest_gap(const thread_stats *st)
+{
+	long tail = (long) ((run_start + st->secs) * 1e9) - (long) st->last_ns;
+
+	return tail > st->max_gap_ns ? tail : st->max_gap_ns;
+}
+
+/**************************************************************************
+
+Function:	print_side()
+
+Use:		Prints one side's longest waits and gaps, thread by
+		thread unless there are too many, and flags the threads
+		that starved.
+
+Arguments:	1. *name: "reader" or "writer".
+		2. *stats: The readers' or writers' results.
+		3. count: How many there are.
+
+Returns:	The number of threads that starved.
+
+**************************************************************************/
+
+int print_side(const char *name, const thread_stats *stats, int count)
+{
+	long max_wait = 0, max_gap = 0, starved = 0;
+	int threads = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		long gap = longest_gap(&stats[i]);
+
+		// A worker pool or executor runs too many to list.
+		if (!pool_mode && !coro_mode)
+		{
+			printf("%s %d: %ld ops, longest wait %.3f ms, longest gap %.3f ms",name,i,stats[i].ops,
+			       stats[i].max_wait_ns / 1e6,gap / 1e6);
+			if (stats[i].ops == 0)
+				printf(", never got the lock: STARVED");
+			else if (stats[i].starved > 0)
+				printf(", %ld waits over %.3f ms: STARVED",stats[i].starved,starve_ns / 1e6);
+			printf("\n");
+		}
+
+		if (stats[i].max_wait_ns > max_wait)
+			max_wait = stats[i].max_wait_ns;
+		if (gap > max_gap)
+			max_gap = gap;
+		// A thread that never got the lock starved, though its
+		// wait never ended to be counted.
+		starved += stats[i].starved;
+		threads += stats[i].starved > 0 || stats[i].ops == 0;
+	}
+
+	printf("%ss: longest wait %.3f ms, longest gap %.3f ms, %d of %d starved (%ld waits over %.3f ms)\n",
+	       name,max_wait / 1e6,max_gap / 1e6,threads,count,starved,starve_ns / 1e6);
+
+	return threads;
+}
+
+/**************************************************************************
+
+Function:	print_fairness()
+
+Use:		Prints each thread's longest wait for the lock and
+		longest gap between getting it, with the threads that
+		starved.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void print_fairness()
+{
+	printf("*** Fairness (policy %s) ***\n",coro_mode ? "async" : policy->name);
+	print_side("reader",rstats,num_readers);
+	if (print_side("writer",wstats,num_writers) > 0)
+		printf("writer starvation detected.\n");
+}
+
+/**************************************************************************
+
+Function:	print_report()
+
+Use:		Prints the benchmark results.
+
+Arguments:	1. wall: The length of the run in seconds.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void print_report(double wall)
+{
+	printf("*** Benchmark Results (%.3f s) ***\n",wall);
+	print_stats("reader",rstats,num_readers,wall);
+	print_stats("writer",wstats,num_writers,wall);
+
+	// Print how evenly each side shared the lock.
+	double rsum = 0, rsum_sq = 0, wsum = 0, wsum_sq = 0;
+	jain_sums(rstats, num_readers, &rsum, &rsum_sq);
+	jain_sums(wstats, num_writers, &wsum, &wsum_sq);
+	printf("fairness (Jain's index): ");
+	print_jain("readers",jain_index(rsum,rsum_sq,num_readers));
+	printf(", ");
+	print_jain("writers",jain_index(wsum,wsum_sq,num_writers));
+	printf("\n");
+
+	// Under an optimistic policy, print how often reads were redone.
+	if (policy->read_begin != NULL)
+	{
+		long retries = 0;
+		for (int i = 0; i < num_readers; i++)
+			retries += rstats[i].retries;
+		printf("reader retries: %ld\n",retries);
+	}
+
+	// Print how fast each side's kernel went through the buffer, and
+	// keep it for a driver.
+	long rbytes = 0, wbytes = 0;
+	for (int i = 0; i < num_readers; i++)
+		rbytes += rstats[i].bytes;
+	for (int i = 0; i < num_writers; i++)
+		wbytes += wstats[i].bytes;
+	last_result.buffer_bytes = shared[0].size;
+	last_result.read_mb_sec = wall > 0 ? rbytes / wall / 1e6 : 0;
+	last_result.write_mb_sec = wall > 0 ? wbytes / wall / 1e6 : 0;
+	if (read_kernel != READ_NONE || write_kernel != WRITE_NONE)
+		printf("kernel throughput (%s): read %.1f MB/s, write %.1f MB/s\n",kernel_isa_name(),
+		       last_result.read_mb_sec,last_result.write_mb_sec);
+
+	// Count every operation, to put the system costs per operation,
+	// and keep the totals for a driver.
+	last_result.secs = wall;
+	last_result.reader_jain = jain_index(rsum,rsum_sq,num_readers);
+	last_result.writer_jain = jain_index(wsum,wsum_sq,num_writers);
+	for (int i = 0; i < num_writers; i++)
+		if (wstats[i].max_wait_ns > last_result.writer_max_wait)
+			last_result.writer_max_wait = wstats[i].max_wait_ns;
+	last_result.cycles_per_op = -1;
+	last_result.llc_misses_per_op = -1;
+	for (int i = 0; i < num_readers; i++)
+		last_result.reads += rstats[i].ops;
+	for (int i = 0; i < num_writers; i++)
+		last_result.writes += wstats[i].ops;
+	long ops = last_result.reads + last_result.writes;
+	if (ops == 0)
+		ops = 1;
+
+	// Print the system calls the policy made, when it counts them.
+	if (policy->syscalls != NULL && !coro_mode)
+		printf("lock system calls: %ld, %.3f per 1000 ops\n",policy->syscalls(),
+		       1000.0 * policy->syscalls() / ops);
+
+	// Under spin-then-park, print how the contended acquires ended.
+	if (spin_max > 0 && !coro_mode)
+	{
+		long won, parked;
+		int budget = policy_spins(&won,&parked);
+		printf("spin-then-park: %ld won spinning, %ld parked, budget %d spins\n",won,parked,budget);
+	}
+
+	// Every thread that blocks in the kernel gives up the processor,
+	// so voluntary context switches count the blocking system calls
+	// of any lock.
+	long vcsw = usage_end.ru_nvcsw - usage_start.ru_nvcsw;
+	long ivcsw = usage_end.ru_nivcsw - usage_start.ru_nivcsw;
+	printf("context switches: %ld voluntary, %.3f per 1000 ops, %ld involuntary\n",vcsw,
+	       1000.0 * vcsw / ops,ivcsw);
+}
+
+/**************************************************************************
+
+Function:	get_usage()
+
+Use:		Reads the resource usage of the readers and writers. As
+		processes they are children, and only count once they
+		have been waited for.
+
+Arguments:	1. *ru: Where to put it.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void get_usage(struct rusage *ru)
+{
+	if (getrusage(process_mode ? RUSAGE_CHILDREN : RUSAGE_SELF, ru) != 0)
+	{
+		fprintf(stderr,"getrusage(): %s.\n",strerror(errno));
+		exit(-1);
+	}
+}
+
+/**************************************************************************
+
+Function:	print_waits()
+
+Use:		Merges the per-thread wait histograms and prints the
+		reader and writer wait percentiles.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void print_waits()
+{
+	static latency_hist rtotal, wtotal;
+
+	// Merge each side's histograms.
+	for (int i = 0; i < nrwaits; i++)
+		hist_merge(&rtotal, &rwaits[i]);
+	for (int i = 0; i < nwwaits; i++)
+		hist_merge(&wtotal, &wwaits[i]);
+
+	// Keep the percentiles for a driver.
+	last_result.read_p50 = hist_percentile(&rtotal,50);
+	last_result.read_p99 = hist_percentile(&rtotal,99);
+	last_result.read_p999 = hist_percentile(&rtotal,99.9);
+	last_result.write_p50 = hist_percentile(&wtotal,50);
+	last_result.write_p99 = hist_percentile(&wtotal,99);
+	last_result.write_p999 = hist_percentile(&wtotal,99.9);
+
+	printf("*** Lock Wait Latency ***\n");
+	hist_print("reader",&rtotal);
+	hist_print("writer",&wtotal);
+}
+
+/**************************************************************************
+
+Function:	by_ops()
+
+Use:		Orders two shards by the operations done in them, most
+		first, for qsort().
+
+Arguments:	1. *a: The first shard's counts.
+		2. *b: The second shard's counts.
+
+Returns:	Less than, equal to or greater than 0 as a comes before,
+		with or after b.
+
+**************************************************************************/
+
+int by_ops(const void *a, const void *b)
+{
+	long x = ((const shard_count *) a)->ops;
+	long y = ((const shard_count *) b)->ops;
+
+	return x > y ? -1 : x < y;
+}
+
+/**************************************************************************
+
+Function:	print_shards()
+
+Use:		Adds up each shard's counts over the threads and prints
+		the hottest shards, with their share of the operations
+		and, under -l, their average lock wait.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void print_shards()
+{
+	// Most shards printed.
+	const int SHOWN = 8;
+
+	shard_count *totals = (shard_count *) calloc(num_shards, sizeof(shard_count));
+	if (totals == NULL)
+	{
+		fprintf(stderr,"calloc(): shard totals - %s.\n",strerror(errno));
+		exit(-1);
+	}
+
+	// Add up every thread's row.
+	long ops = 0;
+	for (int t = 0; t < num_threads; t++)
+	{
+		shard_count *row = (shard_count *) ((char *) shard_counts + t * shard_row);
+		for (int k = 0; k < num_shards; k++)
+		{
+			totals[k].ops += row[k].ops;
+			totals[k].wait_ns += row[k].wait_ns;
+		}
+	}
+	for (int k = 0; k < num_shards; k++)
+		ops += totals[k].ops;
+	if (ops == 0)
+		ops = 1;
+
+	// Print the hottest shards first.
+	qsort(totals, num_shards, sizeof(shard_count), by_ops);
+	printf("*** Shards ***\n");
+	for (int k = 0; k < num_shards && k < SHOWN; k++)
+	{
+		printf("shard #%d: %ld ops, %.1f%% of ops",k + 1,totals[k].ops,100.0 * totals[k].ops / ops);
+		if (time_waits && totals[k].ops > 0)
+			printf(", %.0f ns average wait",(double) totals[k].wait_ns / totals[k].ops);
+		printf("\n");
+	}
+	if (num_shards > SHOWN)
+		printf("(%d more shards)\n",num_shards - SHOWN);
+	printf("hottest shard: %.1f%% of ops, %.1f%% if spread evenly\n",100.0 * totals[0].ops / ops,
+	       100.0 / num_shards);
+
+	free(totals);
+}
+
+/**************************************************************************
+
+Function:	print_batches()
+
+Use:		Adds up the batches the combiners applied and prints how
+		many writes they took, by powers of two.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void print_batches()
+{
+	static batch_stats total;
+
+	// Add up every writer's batches.
+	for (int i = 0; i < num_writers; i++)
+	{
+		for (int b = 0; b < BATCH_BUCKETS; b++)
+			total.counts[b] += batches[i].counts[b];
+		total.batches += batches[i].batches;
+		total.writes += batches[i].writes;
+		if (batches[i].max > total.max)
+			total.max = batches[i].max;
+	}
+
+	printf("*** Combined Write Batches ***\n");
+	printf("batches: %ld, %.2f writes per batch, max %ld\n",total.batches,
+	       total.batches > 0 ? (double) total.writes / total.batches : 0.0,total.max);
+
+	// Print each size that was seen.
+	for (int b = 0; b < BATCH_BUCKETS; b++)
+	{
+		if (total.counts[b] == 0)
+			continue;
+		long low = 1L << b;
+		if (low == 1)
+			printf("size 1: ");
+		else
+			printf("size %ld-%ld: ",low,2 * low - 1);
+		printf("%ld batches, %.1f%%\n",total.counts[b],100.0 * total.counts[b] / total.batches);
+	}
+}
+
+/**************************************************************************
+
+Function:	sum_perf()
+
+Use:		Adds up one side's counts. An event that any thread
+		couldn't count is left out.
+
+Arguments:	1. *counts: The readers' or writers' counts.
+		2. n: How many there are.
+		3. *into: Where to put the totals.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void sum_perf(const perf_counts *counts, int n, perf_counts *into)
+{
+	for (int e = 0; e < PERF_EVENTS; e++)
+	{
+		into->values[e] = 0;
+		for (int i = 0; i < n && into->values[e] >= 0; i++)
+			into->values[e] = counts[i].values[e] < 0 ? -1 : into->values[e] + counts[i].values[e];
+	}
+
+	into->cpu_secs = 0;
+	for (int i = 0; i < n; i++)
+		into->cpu_secs += counts[i].cpu_secs;
+}
+
+/**************************************************************************
+
+Function:	print_perf()
+
+Use:		Prints each event per read and per write, and the CPU
+		time each took.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void print_perf()
+{
+	perf_counts rtotal, wtotal;
+	long reads = 0, writes = 0;
+
+	sum_perf(rperf, num_readers, &rtotal);
+	sum_perf(wperf, num_writers, &wtotal);
+	for (int i = 0; i < num_readers; i++)
+		reads += rstats[i].ops;
+	for (int i = 0; i < num_writers; i++)
+		writes += wstats[i].ops;
+	if (reads == 0)
+		reads = 1;
+	if (writes == 0)
+		writes = 1;
+
+	printf("*** Cost Per Operation (policy %s) ***\n",policy->name);
+	printf("%-20s %12s %12s\n","","per read","per write");
+	for (int e = 0; e < PERF_EVENTS; e++)
+	{
+		// Leave out what the machine can't count.
+		if (rtotal.values[e] < 0 && wtotal.values[e] < 0)
+		{
+			printf("%-20s %12s %12s\n",perf_name(e),"n/a","n/a");
+			continue;
+		}
+		printf("%-20s %12.3f %12.3f\n",perf_name(e),(double) rtotal.values[e] / reads,
+		       (double) wtotal.values[e] / writes);
+	}
+	printf("%-20s %12.1f %12.1f\n","CPU time (ns)",1e9 * rtotal.cpu_secs / reads,
+	       1e9 * wtotal.cpu_secs / writes);
+
+	// Instructions per cycle, when both were counted.
+	if (rtotal.values[PERF_CYCLES] > 0 && rtotal.values[PERF_INSTRUCTIONS] >= 0 &&
+	    wtotal.values[PERF_CYCLES] > 0 && wtotal.values[PERF_INSTRUCTIONS] >= 0)
+		printf("%-20s %12.2f %12.2f\n","IPC",
+		       (double) rtotal.values[PERF_INSTRUCTIONS] / rtotal.values[PERF_CYCLES],
+		       (double) wtotal.values[PERF_INSTRUCTIONS] / wtotal.values[PERF_CYCLES]);
+
+	// Keep the totals per operation for a driver.
+	long ops = reads + writes;
+	last_result.cpu_ns_per_op = 1e9 * (rtotal.cpu_secs + wtotal.cpu_secs) / ops;
+	if (rtotal.values[PERF_CYCLES] >= 0 && wtotal.values[PERF_CYCLES] >= 0)
+		last_result.cycles_per_op = (double) (rtotal.values[PERF_CYCLES] + wtotal.values[PERF_CYCLES]) / ops;
+	if (rtotal.values[PERF_LLC_MISSES] >= 0 && wtotal.values[PERF_LLC_MISSES] >= 0)
+		last_result.llc_misses_per_op = (double) (rtotal.values[PERF_LLC_MISSES] +
+							  wtotal.values[PERF_LLC_MISSES]) / ops;
+}
+
+/**************************************************************************
+
+Function:	count_missed()
+
+Use:		Adds up one side's requests, and those that missed
+		their deadline.
+
+Arguments:	1. *stats: The readers' or writers' results.
+		2. count: How many there are.
+		3. *done: Where to put the requests that got the lock.
+
+Returns:	The requests that missed.
+
+**************************************************************************/
+
+long count_missed(const thread_stats *stats, int count, long *done)
+{
+	long missed = 0;
+
+	*done = 0;
+	for (int i = 0; i < count; i++)
+	{
+		*done += stats[i].ops;
+		missed += stats[i].missed;
+	}
+
+	return missed;
+}
+
+/**************************************************************************
+
+Function:	print_deadlines()
+
+Use:		Prints how many reads and writes got the lock by their
+		deadline and how many gave up, and how often writers
+		were boosted.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void print_deadlines()
+{
+	long reads, writes;
+	long rmissed = count_missed(rstats, num_readers, &reads);
+	long wmissed = count_missed(wstats, num_writers, &writes);
+
+	printf("*** Deadlines (policy %s) ***\n",policy->name);
+	if (read_deadline_ns >= 0)
+		printf("reads: %ld met, %ld missed (%.2f%%) within %.3f ms\n",reads,rmissed,
+		       100.0 * rmissed / (reads + rmissed > 0 ? reads + rmissed : 1),read_deadline_ns / 1e6);
+	if (write_deadline_ns >= 0)
+		printf("writes: %ld met, %ld missed (%.2f%%) within %.3f ms\n",writes,wmissed,
+		       100.0 * wmissed / (writes + wmissed > 0 ? writes + wmissed : 1),write_deadline_ns / 1e6);
+
+	// Only the deadline policy boosts writers.
+	long boosts = policy_boosts();
+	if (boosts > 0)
+		printf("writer boosts: %ld\n",boosts);
+}
+
+/**************************************************************************
+
+Function:	fork_rw()
+
+Use:		Forks a reader or writer process. The child runs the
+		reader or writer, which exits the process when it is
+		done.
+
+Arguments:	1. *body: reader() or writer().
+		2. *name: "reader" or "writer".
+		3. *cpus: The CPUs for its kind of process.
+		4. id: The reader or writer's id.
+
+Returns:	The child's process id.
+
+**************************************************************************/
+
+pid_t fork_rw(void *(*body)(void *), const char *name, const cpu_list *cpus, long id)
+{
+	pid_t pid = fork();
+
+	// Print an error if the fork fails.
+	if (pid < 0)
+	{
+		fprintf(stderr,"fork(): %s %ld error - %s.\n",name,id,strerror(errno));
+		exit(-1);
+	}
+
+	// The child moves to its CPU, then runs the reader or writer.
+	if (pid == 0)
+	{
+		place_self(cpus, id);
+		body((void *) id);
+	}
+
+	return pid;
+}
+
+/**************************************************************************
+
+Function:	wait_rw()
+
+Use:		Waits for a reader or writer process to exit, and checks
+		that it exited cleanly.
+
+Arguments:	1. pid: The process.
+		2. *name: "reader" or "writer".
+		3. id: The reader or writer's id.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void wait_rw(pid_t pid, const char *name, int id)
+{
+	int status;
+
+	// Wait for the process, trying again if a signal gets in.
+	while (waitpid(pid, &status, 0) < 0)
+	{
+		if (errno != EINTR)
+		{
+			fprintf(stderr,"waitpid(): %s %d error - %s.\n",name,id,strerror(errno));
+			exit(-1);
+		}
+	}
+
+	// A process that failed has already said why.
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	{
+		fprintf(stderr,"%s %d did not exit cleanly.\n",name,id);
+		exit(-1);
+	}
+}
+
+/**************************************************************************
+
+Function:	create_rws()
+
+Use:		Creates the reader and writer threads, forks them as
+		processes with -P, runs them on a worker pool with -m, or
+		as coroutines with -a.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void create_rws()
+{
+	// Print the header.
+	printf("*** Reader-Writer Problem Simulation ***\n");
+	printf("Number of reader threads: %d\n",num_readers);
+	printf("Number of writer threads: %d\n",num_writers);
+	if (pool_mode)
+		printf("Worker threads: %d\n",pool_workers);
+	if (coro_mode)
+		printf("Executor threads: %d\n",coro_workers);
+	printf("Lock policy: %s\n",coro_mode ? "async (coroutines)" : policy->name);
+	printf("Buffer size: %zu bytes\n",shared[0].size);
+	if (num_shards > 1)
+	{
+		if (zipf_theta > 0)
+			printf("Shards: %d, keys picked with zipf theta %.2f\n",num_shards,zipf_theta);
+		else
+			printf("Shards: %d, keys picked uniformly\n",num_shards);
+	}
+	if (map_path != NULL)
+		printf("Buffer file: %s\n",map_path);
+	if (process_mode)
+		printf("Readers and writers are processes.\n");
+	if (combining)
+		printf("Writers combine their writes.\n");
+	if (reader_cpus.count > 0)
+		printf("Readers pinned to: %s (%d CPUs)\n",reader_cpus.spec,reader_cpus.count);
+	if (writer_cpus.count > 0)
+		printf("Writers pinned to: %s (%d CPUs)\n",writer_cpus.spec,writer_cpus.count);
+	if (shm_node >= 0)
+		printf("Shared memory on node: %d\n",shm_node);
+	if (trace_path != NULL)
+		printf("Tracing to: %s\n",trace_path);
+	if (read_deadline_ns >= 0)
+		printf("Read deadline: %.3f ms\n",read_deadline_ns / 1e6);
+	if (write_deadline_ns >= 0)
+		printf("Write deadline: %.3f ms\n",write_deadline_ns / 1e6);
+	if (read_kernel != READ_NONE || write_kernel != WRITE_NONE)
+		printf("Kernels: read %s, write %s (%s)\n",kernel_read_name(),kernel_write_name(),kernel_isa_name());
+
+	// Get the header out before readers write to stdout directly.
+	fflush(stdout);
+
+	// Allocate the reader and writer ids, set to the amount of readers
+	// and writers, respectively. They are too many for the stack.
+	pthread_t *rtid = NULL;
+	pthread_t *wtid = NULL;
+	// The same, for processes.
+	pid_t *rpid = NULL;
+	pid_t *wpid = NULL;
+	if (!pool_mode && !coro_mode)
+	{
+		rtid = (pthread_t *) malloc(num_readers * sizeof(pthread_t));
+		wtid = (pthread_t *) malloc(num_writers * sizeof(pthread_t));
+		rpid = (pid_t *) malloc(num_readers * sizeof(pid_t));
+		wpid = (pid_t *) malloc(num_writers * sizeof(pid_t));
+		if (rtid == NULL || wtid == NULL || rpid == NULL || wpid == NULL)
+		{
+			// Print error if it fails.
+			fprintf(stderr,"malloc(): thread ids - %s.\n",strerror(errno));
+			exit(-1);
+		}
+	}
+	// Create a pthread_attr.
+	pthread_attr_t attr;
+
+	// Try to initialize the pthread_attr.
+	if (pthread_attr_init(&attr) != 0)
+	{
+		// Print error if it fails.
+		fprintf(stderr,"pthread_attr_init(): %s.\n",strerror(errno));
+		exit(-1);
+	}
+
+	// Start the logger.
+	log_start(num_threads);
+
+	// Note when the run started, and what it has used so far.
+	get_usage(&usage_start);
+	double start = now_secs();
+	run_start = start;
+
+	// Gaps between getting the lock count from here.
+	for (int i = 0; i < num_readers; i++)
+		rstats[i].last_ns = now_ns();
+	for (int i = 0; i < num_writers; i++)
+		wstats[i].last_ns = now_ns();
+
+	// Hand every reader and writer to the worker pool.
+	if (pool_mode)
+		pool_start(pool_workers, (long) num_readers + num_writers, task_step);
+
+	// Or create every reader and writer coroutine, then start the
+	// executor.
+	if (coro_mode)
+	{
+		for (long i = 0; i < num_readers || i < num_writers; i++)
+		{
+			if (i < num_readers)
+				reader_co(i);
+			if (i < num_writers)
+				writer_co(i);
+		}
+		coro_start(coro_workers);
+	}
+
+	// Or loop through all threads.
+	for  (long i = 0; !pool_mode && !coro_mode && (i < num_readers || i < num_writers); i++)
+	{
+		// Check if the current value of i is less than the first argument.
+		if (i < num_readers)
+		{
+			// If it is, fork a reader process, or try and create a
+			// reader thread.
+			if (process_mode)
+				rpid[i] = fork_rw(reader,"reader",&reader_cpus,i);
+			else
+			{
+				// Pin it, then create it.
+				place_attr(&attr,&reader_cpus,i);
+				if(pthread_create(&rtid[i],&attr,reader,(void *)i) != 0)
+				{
+					// Print an error.
+					fprintf(stderr,"pthread_create(): reader %ld error - %s.\n",i,strerror(errno));
+					exit(-1);
+				}
+			}
+		}
+		// Check if the current value of i is less than the second argument.
+		if (i < num_writers)
+		{
+			// If it is, fork a writer process, or try and create a
+			// writer thread.
+			if (process_mode)
+				wpid[i] = fork_rw(writer,"writer",&writer_cpus,i);
+			else
+			{
+				// Pin it, then create it.
+				place_attr(&attr,&writer_cpus,i);
+				if(pthread_create(&wtid[i],&attr,writer,(void *)i) != 0)
+				{
+					// Print an error.
+					fprintf(stderr,"pthread_create(): writer %ld error - %s.\n",i,strerror(errno));
+					exit(-1);
+				}
+			}
+		}
+	}
+
+	// In a timed benchmark, let the threads run, then tell them to stop.
+	if (bench_mode && bench_ops == 0)
+	{
+		// Sleep for the length of the run.
+		if (sleep(bench_secs) != 0)
+		{
+			// Print error on fail.
+			fprintf(stderr,"sleep(): %s.\n",strerror(errno));
+			exit(-1);
+		}
+
+		// Tell the threads to stop.
+		end_run();
+	}
+
+	// Wait for the worker pool to finish every task, or for every
+	// coroutine to return.
+	if (pool_mode)
+		pool_wait();
+	if (coro_mode)
+		coro_wait();
+
+	// Or loop through the rtid array.
+	for (int i = 0; !pool_mode && !coro_mode && i < num_readers; i++)
+	{
+		// Wait for the process, or join the thread at the current
+		// value of rtid.
+		if (process_mode)
+			wait_rw(rpid[i],"reader",i);
+		else if(pthread_join(rtid[i],NULL) != 0)
+		{
+			// Print an error on fail.
+			fprintf(stderr,"pthread_join(): reader %d error - %s.\n",i,strerror(errno));
+			exit(-1);
+		}
+	}
+	// Loop through the wtid array.
+	for (int i = 0; !pool_mode && !coro_mode && i < num_writers; i++)
+	{
+		// Wait for the process, or join the thread at the current
+		// value of wtid.
+		if (process_mode)
+			wait_rw(wpid[i],"writer",i);
+		else if(pthread_join(wtid[i],NULL) != 0)
+		{
+			// Print an error on fail.
+			fprintf(stderr,"pthread_join(): writer %d error - %s.\n",i,strerror(errno));
+			exit(-1);
+		}
+	}
+
+	// Note what the run used.
+	get_usage(&usage_end);
+
+	// Free the ids.
+	free(rtid);
+	free(wtid);
+	free(rpid);
+	free(wpid);
+
+	// Print what is left in the log.
+	log_stop();
+
+	// Tell the user that the threads are done.
+	printf("All threads are done.\n");
+
+	// Print the benchmark results.
+	if (bench_mode)
+		print_report(now_secs() - start);
+
+	// Print the lock wait percentiles.
+	if (time_waits)
+		print_waits();
+
+	// Print how the work spread over the shards.
+	if (num_shards > 1)
+		print_shards();
+
+	// Print the sizes of the combined batches.
+	if (combining)
+		print_batches();
+
+	// Print each thread's longest waits, and who starved.
+	if (fair_mode)
+		print_fairness();
+
+	// Print how many requests missed their deadlines.
+	if (read_deadline_ns >= 0 || write_deadline_ns >= 0)
+		print_deadlines();
+
+	// Print what the operations cost the machine.
+	if (perf_on && bench_mode)
+		print_perf();
+
+	// Write out the trace.
+	if (trace_path != NULL)
+	{
+		char title[128];
+		snprintf(title, sizeof(title), "readerwriter (policy %s)", policy->name);
+		trace_write(title, num_readers, num_writers);
+	}
+}
+
+/**************************************************************************
+
+Function:	cleanup()
+
+Use:		Cleans up the memory.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void cleanup()
+{
+	// Clean up the lock policy, then each shard's last snapshot and
+	// buffer.
+	policy_destroy();
+	for (int k = 0; k < num_shards; k++)
+	{
+		if (policy->retire != NULL)
+			free(snapshot[k].load());
+		buffer_destroy(&shared[k]);
+	}
+	delete[] snapshot;
+	delete[] async_locks;
+	shared_free(shared);
+	shared_free(run);
+
+	// Close the readers' output.
+	if (out_fd >= 0 && out_fd != STDOUT_FILENO)
+		close(out_fd);
+
+	// Free the per-thread results.
+	shared_free(rstats);
+	shared_free(wstats);
+	shared_free(rwaits);
+	shared_free(wwaits);
+	shared_free(shard_counts);
+	shared_free(rperf);
+	shared_free(wperf);
+	trace_free();
+	shared_free(pub_slots);
+	shared_free(combiners);
+	shared_free(batches);
+	free(pool_copies);
+	place_free(&reader_cpus);
+	place_free(&writer_cpus);
+
+	// Tell the user that the resources are cleaned up.
+	printf("Resources cleaned up.\n");
+}
+
+/**************************************************************************
+
+Function:	rw_main()
+
+Use:		Checks arguments, intiializes variables, Creates reader
+		and writer threads, then cleans them up.
+
+Arguments:	1. argc: The number of arguments.
+		2. *argv[]: A char * string that holds the arguments.
+		3. *default_policy: The policy used when -p isn't given.
+
+Returns:	The program's exit status.
+
+**************************************************************************/
+
+int rw_main(int argc, char *argv[], const char *default_policy)
+{
+	// Use the program's default policy unless -p picks another.
+	prog_name = argv[0];
+	policy = find_policy(default_policy);
+
+	// Check the arguments.
+	check_args(argc, argv);
+
+	// Initialize the variables.
+	init_vars();
+
+	// Create the threads.
+	create_rws();
+
+	// Cleanup the program.
+	cleanup();
+
+	// Exit successfully.
+	return 0;
+}
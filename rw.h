@@ -0,0 +1,79 @@
+/**************************************************************************
+
+Reader/Writer Problem - Simulation
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Declares the reader/writer simulation shared by the
+		readerwriter and readerwriter_p2 programs.
+
+**************************************************************************/
+#ifndef RW_H
+#define RW_H
+
+#include <stdint.h>
+#include "hist.h"
+
+// Per-reader and per-writer benchmark results. Each sits in its own
+// cache line, so threads never write the same line.
+struct alignas(64) thread_stats
+{
+	long ops;		// Completed operations.
+	long bytes;		// Bytes seen by a reader, or run through a
+				// writer's kernel.
+	double secs;		// Time the thread spent in its loop.
+	long retries;		// Optimistic reads that had to be done again.
+	long max_wait_ns;	// Longest wait for the lock, with -l or -F.
+	long max_gap_ns;	// Longest time between getting the lock.
+	long starved;		// Waits longer than the bound given with -F.
+	uint64_t last_ns;	// When the thread last got the lock.
+	long missed;		// Requests that missed their deadline, with -d
+				// or -D.
+	uint64_t digest;	// What a reader's kernel made of its reads.
+};
+
+// Number of readers and writers.
+extern int num_readers;
+extern int num_writers;
+
+// Number of threads or processes that take the lock. It is the number
+// of workers when a worker pool runs the readers and writers.
+extern int num_threads;
+
+// Benchmark settings, set by check_args().
+extern bool bench_mode;
+extern int bench_secs;
+extern long bench_ops;
+extern bool time_waits;
+
+// The results of the last benchmark run, for a driver that runs
+// rw_main() and collects them. The latencies are 0 without -l.
+struct bench_result
+{
+	double secs;		// Length of the run.
+	long reads;
+	long writes;
+	uint64_t read_p50;	// Lock wait percentiles, in ns.
+	uint64_t read_p99;
+	uint64_t read_p999;
+	uint64_t write_p50;
+	uint64_t write_p99;
+	uint64_t write_p999;
+	double cpu_ns_per_op;	// With -H. The events are -1 when they
+	double cycles_per_op;	// couldn't be counted.
+	double llc_misses_per_op;
+	double reader_jain;	// Jain's fairness index of each side, or -1
+	double writer_jain;	// when the side did no work.
+	long writer_max_wait;	// Longest writer wait in ns, with -l.
+	long buffer_bytes;	// Size of each shard's buffer.
+	double read_mb_sec;	// Bytes read, and run through the writers'
+	double write_mb_sec;	// kernels, in MB per second.
+};
+extern bench_result last_result;
+
+double now_secs();
+uint64_t now_ns();
+int rw_main(int argc, char *argv[], const char *default_policy);
+
+#endif
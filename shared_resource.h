@@ -0,0 +1,473 @@
+/**************************************************************************
+
+Reader/Writer Problem - Shared Resource
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	A resource guarded by a reader/writer lock, for use
+		outside the simulation. SharedResource<T, Policy> holds a
+		T and a lock policy, picked when it is compiled, so
+		taking the lock inlines with no function pointers.
+		Reads and writes go through guards that release the
+		lock when they go out of scope.
+
+		The policies are the semaphore locks the simulation
+		runs: reader priority, writer priority and alternating.
+		Each is a template on the semaphore it waits on and on
+		what it tells about read_count, so the simulation can
+		time, trace and log them and anyone else gets plain
+		POSIX semaphores for free:
+
+			SharedResource<config, writer_pref_lock<> > conf;
+
+			{
+				auto r = conf.read();
+				use(r->port);
+			}
+			if (auto w = conf.try_write(resource_now_ns() + 1000000))
+				w->version++;
+
+		Everything is in this header. Errors are printed and end
+		the program, as in the rest of the simulation.
+
+**************************************************************************/
+#ifndef SHARED_RESOURCE_H
+#define SHARED_RESOURCE_H
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <semaphore.h>
+
+/**************************************************************************
+
+Function:	resource_now_ns()
+
+Use:		Reads the clock deadlines are given on.
+
+Arguments:	None.
+
+Returns:	The CLOCK_MONOTONIC time in ns.
+
+**************************************************************************/
+
+inline uint64_t resource_now_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// A POSIX semaphore, the default for every policy.
+struct posix_sem
+{
+	sem_t sem;
+	const char *name;	// For errors.
+
+	// Initializes it, shared between processes when pshared is set.
+	void init(unsigned value, bool pshared, const char *sem_name)
+	{
+		name = sem_name;
+		if (sem_init(&sem, pshared, value) != 0)
+		{
+			fprintf(stderr,"sem_init(): %s semaphore error - %s.\n",name,strerror(errno));
+			exit(-1);
+		}
+	}
+
+	// Waits on it, trying again if a signal gets in.
+	void wait()
+	{
+		while (sem_wait(&sem) != 0)
+		{
+			if (errno != EINTR)
+			{
+				fprintf(stderr,"sem_wait(): %s semaphore error - %s.\n",name,strerror(errno));
+				exit(-1);
+			}
+		}
+	}
+
+	// Waits on it until the deadline on CLOCK_MONOTONIC, or only
+	// tries it if that has passed. Returns false if it wasn't taken.
+	bool wait_until(uint64_t deadline)
+	{
+		if (sem_trywait(&sem) == 0)
+			return true;
+
+		// Only a taken semaphore is a reason to wait. Anything
+		// else is an error, not a timeout.
+		if (errno != EAGAIN)
+		{
+			fprintf(stderr,"sem_trywait(): %s semaphore error - %s.\n",name,strerror(errno));
+			exit(-1);
+		}
+
+		// sem_timedwait() wants the time on CLOCK_REALTIME.
+		uint64_t now = resource_now_ns();
+		if (deadline <= now)
+			return false;
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		uint64_t at = (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec + (deadline - now);
+		ts.tv_sec = at / 1000000000;
+		ts.tv_nsec = at % 1000000000;
+
+		int ret;
+		while ((ret = sem_timedwait(&sem, &ts)) != 0 && errno == EINTR)
+			;
+		if (ret != 0 && errno != ETIMEDOUT)
+		{
+			fprintf(stderr,"sem_timedwait(): %s semaphore error - %s.\n",name,strerror(errno));
+			exit(-1);
+		}
+		return ret == 0;
+	}
+
+	// Signals it.
+	void post()
+	{
+		if (sem_post(&sem) != 0)
+		{
+			fprintf(stderr,"sem_post(): %s semaphore error - %s.\n",name,strerror(errno));
+			exit(-1);
+		}
+	}
+
+	void destroy()
+	{
+		if (sem_destroy(&sem) != 0)
+		{
+			fprintf(stderr,"sem_destroy(): %s semaphore error - %s.\n",name,strerror(errno));
+			exit(-1);
+		}
+	}
+};
+
+// Hears nothing of read_count, the default for every policy.
+struct no_events
+{
+	static void read_count(int, bool) {}
+};
+
+// Reader priority. The first reader locks out the writers, and the last
+// one lets them back in.
+template <typename Sem = posix_sem, typename Events = no_events>
+struct reader_pref_lock
+{
+	Sem rw_sem;
+	Sem cs_sem;
+	int read_count;
+
+	void init(bool pshared)
+	{
+		rw_sem.init(1, pshared, "reader/writer");
+		cs_sem.init(1, pshared, "critical section");
+		read_count = 0;
+	}
+
+	void read_lock()
+	{
+		cs_sem.wait();						// IN CRITICAL SECTION
+
+		// The first reader waits for the writer.
+		Events::read_count(++read_count, true);
+		if (read_count == 1)
+			rw_sem.wait();
+
+		cs_sem.post();						// OUT OF CRITICAL SECTION
+	}
+
+	void read_unlock()
+	{
+		cs_sem.wait();						// IN CRITICAL SECTION
+
+		// The last reader signals the writer.
+		Events::read_count(--read_count, false);
+		if (read_count == 0)
+			rw_sem.post();
+
+		cs_sem.post();						// OUT OF CRITICAL SECTION
+	}
+
+	void write_lock()
+	{
+		rw_sem.wait();
+	}
+
+	void write_unlock()
+	{
+		rw_sem.post();
+	}
+
+	// The same, by a deadline. A first reader that runs out of time
+	// takes itself back out.
+	bool read_lock_until(uint64_t deadline)
+	{
+		if (!cs_sem.wait_until(deadline))
+			return false;
+
+		bool got = true;
+		Events::read_count(++read_count, true);
+		if (read_count == 1 && !rw_sem.wait_until(deadline))
+		{
+			Events::read_count(--read_count, false);
+			got = false;
+		}
+
+		cs_sem.post();
+		return got;
+	}
+
+	bool write_lock_until(uint64_t deadline)
+	{
+		return rw_sem.wait_until(deadline);
+	}
+
+	void destroy()
+	{
+		rw_sem.destroy();
+		cs_sem.destroy();
+	}
+};
+
+// Writer priority. Readers have to get through try_sem, which the first
+// waiting writer holds until the last writer is done.
+template <typename Sem = posix_sem, typename Events = no_events>
+struct writer_pref_lock
+{
+	reader_pref_lock<Sem, Events> rp;
+	Sem try_sem;
+	Sem wc_sem;
+	int write_count;
+
+	void init(bool pshared)
+	{
+		rp.init(pshared);
+		try_sem.init(1, pshared, "read try");
+		wc_sem.init(1, pshared, "write count");
+		write_count = 0;
+	}
+
+	void read_lock()
+	{
+		// Wait until no writer is waiting, then take the lock the
+		// same way as under reader priority.
+		try_sem.wait();
+		rp.read_lock();
+		try_sem.post();
+	}
+
+	void read_unlock()
+	{
+		rp.read_unlock();
+	}
+
+	void write_lock()
+	{
+		// The first writer stops new readers.
+		wc_sem.wait();
+		if (++write_count == 1)
+			try_sem.wait();
+		wc_sem.post();
+
+		// Wait for the readers and other writers.
+		rp.rw_sem.wait();
+	}
+
+	void write_unlock()
+	{
+		rp.rw_sem.post();
+		leave();
+	}
+
+	// The same, by a deadline. A writer that runs out of time takes
+	// itself out of write_count.
+	bool read_lock_until(uint64_t deadline)
+	{
+		if (!try_sem.wait_until(deadline))
+			return false;
+		bool got = rp.read_lock_until(deadline);
+		try_sem.post();
+		return got;
+	}
+
+	bool write_lock_until(uint64_t deadline)
+	{
+		if (!wc_sem.wait_until(deadline))
+			return false;
+		if (++write_count == 1 && !try_sem.wait_until(deadline))
+		{
+			write_count--;
+			wc_sem.post();
+			return false;
+		}
+		wc_sem.post();
+
+		if (rp.rw_sem.wait_until(deadline))
+			return true;
+		leave();
+		return false;
+	}
+
+	void destroy()
+	{
+		rp.destroy();
+		try_sem.destroy();
+		wc_sem.destroy();
+	}
+
+private:
+	// Takes a writer out of write_count. The last one lets readers
+	// back in.
+	void leave()
+	{
+		wc_sem.wait();
+		if (--write_count == 0)
+			try_sem.post();
+		wc_sem.post();
+	}
+};
+
+// Readers and writers take strict turns, starting with a reader.
+template <typename Sem = posix_sem, typename Events = no_events>
+struct alternate_lock
+{
+	Sem write_sem;
+	Sem read_sem;
+
+	void init(bool pshared)
+	{
+		write_sem.init(0, pshared, "write");
+		read_sem.init(1, pshared, "read");
+	}
+
+	void read_lock()
+	{
+		read_sem.wait();
+	}
+
+	// Hands the turn to a writer.
+	void read_unlock()
+	{
+		write_sem.post();
+	}
+
+	void write_lock()
+	{
+		write_sem.wait();
+	}
+
+	// Hands the turn to a reader.
+	void write_unlock()
+	{
+		read_sem.post();
+	}
+
+	// Signals every reader and writer once, so those waiting for a
+	// turn that will never come can go.
+	void release(int readers, int writers)
+	{
+		for (int i = 0; i < readers; i++)
+			read_sem.post();
+		for (int i = 0; i < writers; i++)
+			write_sem.post();
+	}
+
+	void destroy()
+	{
+		write_sem.destroy();
+		read_sem.destroy();
+	}
+};
+
+// A T that is read and written under a Policy lock.
+template <typename T, typename Policy>
+class SharedResource
+{
+public:
+	// Reads the resource until it goes out of scope. One from
+	// try_read() that didn't get the lock is false and holds nothing.
+	class read_guard
+	{
+	public:
+		explicit read_guard(SharedResource *r) : res(r) {}
+		read_guard(read_guard &&other) : res(other.res) { other.res = NULL; }
+		read_guard(const read_guard &) = delete;
+		read_guard &operator=(const read_guard &) = delete;
+		~read_guard() { if (res != NULL) res->lock.read_unlock(); }
+
+		explicit operator bool() const { return res != NULL; }
+		const T &operator*() const { return res->value; }
+		const T *operator->() const { return &res->value; }
+
+	private:
+		SharedResource *res;
+	};
+
+	// Writes the resource until it goes out of scope.
+	class write_guard
+	{
+	public:
+		explicit write_guard(SharedResource *r) : res(r) {}
+		write_guard(write_guard &&other) : res(other.res) { other.res = NULL; }
+		write_guard(const write_guard &) = delete;
+		write_guard &operator=(const write_guard &) = delete;
+		~write_guard() { if (res != NULL) res->lock.write_unlock(); }
+
+		explicit operator bool() const { return res != NULL; }
+		T &operator*() const { return res->value; }
+		T *operator->() const { return &res->value; }
+
+	private:
+		SharedResource *res;
+	};
+
+	// Set pshared when the resource is in memory shared between
+	// processes.
+	explicit SharedResource(bool pshared = false) : value() { lock.init(pshared); }
+	explicit SharedResource(const T &init, bool pshared = false) : value(init) { lock.init(pshared); }
+	SharedResource(const SharedResource &) = delete;
+	SharedResource &operator=(const SharedResource &) = delete;
+	~SharedResource() { lock.destroy(); }
+
+	read_guard read()
+	{
+		lock.read_lock();
+		return read_guard(this);
+	}
+
+	write_guard write()
+	{
+		lock.write_lock();
+		return write_guard(this);
+	}
+
+	// Take it by a deadline from resource_now_ns(), or only try once
+	// if the deadline has passed. Only policies that can give up
+	// have these.
+	read_guard try_read(uint64_t deadline)
+	{
+		return read_guard(lock.read_lock_until(deadline) ? this : NULL);
+	}
+
+	write_guard try_write(uint64_t deadline)
+	{
+		return write_guard(lock.write_lock_until(deadline) ? this : NULL);
+	}
+
+	// The lock itself, for what only it can do, like
+	// alternate_lock::release().
+	Policy &policy() { return lock; }
+
+private:
+	T value;
+	Policy lock;
+};
+
+#endif
@@ -0,0 +1,173 @@
+/**************************************************************************
+
+Reader/Writer Problem - Shared Memory
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Allocates the memory the readers and writers share. With
+		threads it is ordinary memory. With processes, each
+		allocation is its own POSIX shared memory segment, mapped
+		shared before the readers and writers are forked so they
+		all see it at the same address. The segment's name is
+		unlinked as soon as it is mapped, so nothing is left
+		behind if the program dies.
+
+		With -N, every allocation is bound to one NUMA node
+		with mbind() before it is first touched, so its pages
+		are placed there whichever thread touches them.
+
+**************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include "shm.h"
+
+// Room in front of each segment for its size. It is a cache line, so
+// what follows stays lined up.
+const size_t SHM_HEADER = 64;
+
+bool process_mode = false;
+int shm_node = -1;
+
+// Segments made so far, to give each one its own name.
+int segments = 0;
+
+/**************************************************************************
+
+Function:	bind_node()
+
+Use:		Binds memory that hasn't been touched yet to the chosen
+		NUMA node.
+
+Arguments:	1. *mem: The memory, lined up on a page.
+		2. size: Its size.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void bind_node(void *mem, size_t size)
+{
+	unsigned long mask[16] = {};
+
+	// Allow only the chosen node.
+	mask[shm_node / 64] |= 1UL << (shm_node % 64);
+	if (syscall(SYS_mbind, mem, size, MPOL_BIND, mask, sizeof(mask) * 8, 0) != 0)
+	{
+		fprintf(stderr,"mbind(): node %d - %s.\n",shm_node,strerror(errno));
+		exit(-1);
+	}
+}
+
+/**************************************************************************
+
+Function:	shared_alloc()
+
+Use:		Allocates cleared memory lined up on a cache line, that
+		every reader and writer can use.
+
+Arguments:	1. size: The number of bytes.
+
+Returns:	The memory.
+
+**************************************************************************/
+
+void *shared_alloc(size_t size)
+{
+	void *mem;
+
+	// With threads, ordinary memory will do, unless it has to be on
+	// a node.
+	if (!process_mode && shm_node < 0)
+	{
+		if (posix_memalign(&mem, SHM_HEADER, size) != 0)
+		{
+			fprintf(stderr,"posix_memalign(): %zu bytes - out of memory.\n",size);
+			exit(-1);
+		}
+		memset(mem, 0, size);
+		return mem;
+	}
+
+	// With threads, map cleared memory of the program's own.
+	if (!process_mode)
+	{
+		mem = mmap(NULL, SHM_HEADER + size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem == MAP_FAILED)
+		{
+			fprintf(stderr,"mmap(): %zu bytes - %s.\n",size,strerror(errno));
+			exit(-1);
+		}
+	}
+	// With processes, make a new segment and unlink its name
+	// straight away.
+	else
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "/readerwriter.%d.%d", (int) getpid(), segments++);
+		int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd < 0)
+		{
+			fprintf(stderr,"shm_open(): %s - %s.\n",name,strerror(errno));
+			exit(-1);
+		}
+		shm_unlink(name);
+
+		// Size it, which also clears it, and map it shared.
+		if (ftruncate(fd, SHM_HEADER + size) != 0)
+		{
+			fprintf(stderr,"ftruncate(): %s - %s.\n",name,strerror(errno));
+			exit(-1);
+		}
+		mem = mmap(NULL, SHM_HEADER + size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (mem == MAP_FAILED)
+		{
+			fprintf(stderr,"mmap(): %s - %s.\n",name,strerror(errno));
+			exit(-1);
+		}
+		close(fd);
+	}
+
+	// Put it on the node before the header touches it.
+	if (shm_node >= 0)
+		bind_node(mem, SHM_HEADER + size);
+
+	// Note the size for shared_free().
+	*(size_t *) mem = size;
+	return (char *) mem + SHM_HEADER;
+}
+
+/**************************************************************************
+
+Function:	shared_free()
+
+Use:		Frees memory from shared_alloc().
+
+Arguments:	1. *mem: The memory, or NULL.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void shared_free(void *mem)
+{
+	if (mem == NULL)
+		return;
+
+	if (!process_mode && shm_node < 0)
+	{
+		free(mem);
+		return;
+	}
+
+	// Unmap the whole mapping, header and all.
+	char *seg = (char *) mem - SHM_HEADER;
+	munmap(seg, SHM_HEADER + *(size_t *) seg);
+}
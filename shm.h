@@ -0,0 +1,28 @@
+/**************************************************************************
+
+Reader/Writer Problem - Shared Memory
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Declares the allocator for everything the readers and
+		writers share. With -P they are processes, and it comes
+		from shm_open() segments that survive fork().
+
+**************************************************************************/
+#ifndef SHM_H
+#define SHM_H
+
+#include <stddef.h>
+
+// Readers and writers are forked processes, not threads, when set.
+extern bool process_mode;
+
+// NUMA node the memory is placed on, set with -N, or -1 to leave it to
+// the kernel.
+extern int shm_node;
+
+void *shared_alloc(size_t size);
+void shared_free(void *mem);
+
+#endif
@@ -0,0 +1,267 @@
+/**************************************************************************
+
+Reader/Writer Problem - Lock Tracing
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Records every semaphore wait and post with -T. Each
+		reader and writer gets a buffer of its own before the run
+		starts, so recording is a store and a time stamp, with no
+		lock. Time stamps come from the time stamp counter where
+		there is one, and are turned into microseconds by timing
+		it against the clock over the run. When the run is done
+		the events are written as Chrome trace JSON: a slice for
+		each wait, and a mark for each time a semaphore was taken
+		or posted, on one track per reader and writer.
+
+**************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "trace.h"
+#include "shm.h"
+
+const char *trace_path = NULL;
+thread_local trace_buffer *my_trace = NULL;
+
+// Every thread's buffer, and the events they point into.
+trace_buffer *traces = NULL;
+trace_event *trace_store = NULL;
+int trace_threads = 0;
+
+// The counter and the clock when tracing started, to convert one to
+// the other.
+uint64_t tsc_start;
+uint64_t clock_start;
+
+/**************************************************************************
+
+Function:	clock_ns()
+
+Use:		Reads the monotonic clock.
+
+Arguments:	None.
+
+Returns:	The time in ns.
+
+**************************************************************************/
+
+uint64_t clock_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**************************************************************************
+
+Function:	read_tsc()
+
+Use:		Reads the time stamp counter, or the clock on
+		processors without one.
+
+Arguments:	None.
+
+Returns:	The count.
+
+**************************************************************************/
+
+uint64_t read_tsc()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return clock_ns();
+#endif
+}
+
+/**************************************************************************
+
+Function:	trace_init()
+
+Use:		Makes a buffer for every reader and writer, where the
+		processes can all see them.
+
+Arguments:	1. threads: The number of readers and writers.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void trace_init(int threads)
+{
+	trace_threads = threads;
+	traces = (trace_buffer *) shared_alloc(threads * sizeof(trace_buffer));
+	trace_store = (trace_event *) shared_alloc(threads * TRACE_EVENTS * sizeof(trace_event));
+
+	for (int i = 0; i < threads; i++)
+		traces[i].events = &trace_store[i * TRACE_EVENTS];
+
+	// Note where the counter and the clock start.
+	tsc_start = read_tsc();
+	clock_start = clock_ns();
+}
+
+/**************************************************************************
+
+Function:	trace_attach()
+
+Use:		Starts recording the calling thread's events in its
+		buffer.
+
+Arguments:	1. index: The thread's buffer: readers first, then
+		          writers.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void trace_attach(int index)
+{
+	my_trace = &traces[index];
+	my_trace->tid = syscall(SYS_gettid);
+}
+
+/**************************************************************************
+
+Function:	trace_add()
+
+Use:		Records an event in the calling thread's buffer, or
+		counts it as dropped if the buffer is full.
+
+Arguments:	1. kind: What happened.
+		2. *name: The semaphore's name.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void trace_add(int kind, const char *name)
+{
+	if (my_trace->count == TRACE_EVENTS)
+	{
+		my_trace->dropped++;
+		return;
+	}
+
+	trace_event *e = &my_trace->events[my_trace->count++];
+	e->tsc = read_tsc();
+	e->name = name;
+	e->kind = kind;
+}
+
+/**************************************************************************
+
+Function:	trace_write()
+
+Use:		Writes every thread's events to the trace file as
+		Chrome trace JSON. A wait becomes a slice from when it
+		started to when the semaphore was taken.
+
+Arguments:	1. *title: What the run was, for the process's name.
+		2. readers: The number of readers.
+		3. writers: The number of writers.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void trace_write(const char *title, int readers, int writers)
+{
+	// Work out how many counts there are to a microsecond.
+	double ticks_per_us = (double) (read_tsc() - tsc_start) / ((clock_ns() - clock_start) / 1000.0);
+	if (ticks_per_us <= 0)
+		ticks_per_us = 1000;
+
+	FILE *out = fopen(trace_path, "w");
+	if (out == NULL)
+	{
+		fprintf(stderr,"fopen(): %s - %s.\n",trace_path,strerror(errno));
+		exit(-1);
+	}
+
+	// Name the process and a track for every reader and writer.
+	fprintf(out,"{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+	fprintf(out,"{\"ph\": \"M\", \"name\": \"process_name\", \"pid\": 1, \"tid\": 0, "
+		"\"args\": {\"name\": \"%s\"}}",title);
+	long events = 0, dropped = 0;
+	for (int t = 0; t < trace_threads; t++)
+	{
+		const trace_buffer *b = &traces[t];
+		fprintf(out,",\n{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": %d, "
+			"\"args\": {\"name\": \"%s %d (tid %ld)\"}}",t,t < readers ? "reader" : "writer",
+			t < readers ? t : t - readers,b->tid);
+		fprintf(out,",\n{\"ph\": \"M\", \"name\": \"thread_sort_index\", \"pid\": 1, \"tid\": %d, "
+			"\"args\": {\"sort_index\": %d}}",t,t);
+
+		// Go through the thread's events in order, pairing each
+		// wait's start with when it got the semaphore.
+		const trace_event *attempt = NULL;
+		for (long i = 0; i < b->count; i++)
+		{
+			const trace_event *e = &b->events[i];
+			double ts = (double) (int64_t) (e->tsc - tsc_start) / ticks_per_us;
+
+			if (e->kind == TRACE_ATTEMPT)
+			{
+				attempt = e;
+				continue;
+			}
+
+			// The wait, then the mark.
+			if (e->kind == TRACE_ACQUIRE && attempt != NULL && attempt->name == e->name)
+			{
+				double begin = (double) (int64_t) (attempt->tsc - tsc_start) / ticks_per_us;
+				fprintf(out,",\n{\"ph\": \"X\", \"cat\": \"wait\", \"name\": \"wait %s\", \"pid\": 1, "
+					"\"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",e->name,t,begin,ts - begin);
+			}
+			attempt = NULL;
+			fprintf(out,",\n{\"ph\": \"i\", \"s\": \"t\", \"cat\": \"lock\", \"name\": \"%s %s\", "
+				"\"pid\": 1, \"tid\": %d, \"ts\": %.3f}",e->kind == TRACE_ACQUIRE ? "acquire" : "release",
+				e->name,t,ts);
+		}
+		events += b->count;
+		dropped += b->dropped;
+	}
+	fprintf(out,"\n]}\n");
+
+	if (fclose(out) != 0)
+	{
+		fprintf(stderr,"fclose(): %s - %s.\n",trace_path,strerror(errno));
+		exit(-1);
+	}
+
+	printf("Trace: %ld events from %d readers and %d writers written to %s",events,readers,writers,trace_path);
+	if (dropped > 0)
+		printf(", %ld dropped when buffers filled",dropped);
+	printf(".\n");
+}
+
+/**************************************************************************
+
+Function:	trace_free()
+
+Use:		Frees the buffers.
+
+Arguments:	None.
+
+Returns:	Nothing.
+
+**************************************************************************/
+
+void trace_free()
+{
+	shared_free(traces);
+	shared_free(trace_store);
+	traces = NULL;
+	trace_store = NULL;
+}
@@ -0,0 +1,58 @@
+/**************************************************************************
+
+Reader/Writer Problem - Lock Tracing
+
+Programmer: 	Caleb Patsch
+Date:			11/5/2023
+
+Purpose:	Declares the per-thread buffers that every semaphore wait
+		and post is recorded in with -T, and written out as a
+		Chrome trace for Perfetto or chrome://tracing.
+
+**************************************************************************/
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+// Most events each thread keeps. The rest are counted and dropped.
+const long TRACE_EVENTS = 1 << 16;
+
+// What happened to a semaphore.
+enum trace_kind
+{
+	TRACE_ATTEMPT,		// Started waiting for it.
+	TRACE_ACQUIRE,		// Got it.
+	TRACE_RELEASE		// Posted it.
+};
+
+struct trace_event
+{
+	uint64_t tsc;		// Time stamp counter when it happened.
+	const char *name;	// The semaphore's name.
+	int kind;
+};
+
+// One reader or writer's events.
+struct trace_buffer
+{
+	trace_event *events;
+	long count;
+	long dropped;		// Events there was no room for.
+	long tid;		// The thread's id from the kernel.
+};
+
+// The file the trace is written to, given with -T, or NULL.
+extern const char *trace_path;
+
+// The buffer the current thread records into, or NULL if it isn't
+// being traced.
+extern thread_local trace_buffer *my_trace;
+
+void trace_init(int threads);
+void trace_attach(int index);
+void trace_add(int kind, const char *name);
+void trace_write(const char *title, int readers, int writers);
+void trace_free();
+
+#endif